@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 1) in vec4 vertexColor;
+
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
+
+out vec4 color;
+
+void main() {
+  color = vertexColor;
+  gl_Position = viewProjection * vec4(vertexPosition, 1.0);
+}
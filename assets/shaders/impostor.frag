@@ -0,0 +1,32 @@
+#version 330 core
+
+in vec2 uv;
+in float fade;
+
+out vec4 fragColor;
+
+uniform sampler2D atlas;
+
+const float kBayer[16] = float[](
+  0.0, 8.0, 2.0, 10.0,
+  12.0, 4.0, 14.0, 6.0,
+  3.0, 11.0, 1.0, 9.0,
+  15.0, 7.0, 13.0, 5.0
+);
+
+void main() {
+  vec4 color = texture(atlas, uv);
+  if (color.a < 0.5) {
+    discard;
+  }
+
+  ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+  float threshold = (kBayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+
+  // the other half of the dither model_instanced.frag drops
+  if (fade <= threshold) {
+    discard;
+  }
+
+  fragColor = vec4(color.rgb, 1.0);
+}
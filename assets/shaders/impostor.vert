@@ -0,0 +1,53 @@
+#version 330 core
+// xyz bounds center, w half size of the quad
+layout (location = 0) in vec4 instanceCenter;
+// xyz placed position, w atlas row
+layout (location = 1) in vec4 instanceOrigin;
+layout (location = 2) in float instanceYaw;
+
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
+
+uniform vec2 fade_range;
+// x views per asset, y atlas rows
+uniform vec2 atlas_grid;
+
+out vec2 uv;
+out float fade;
+
+const float kTwoPi = 6.28318530718;
+
+void main() {
+  // drawn as a 4 vertex strip without any vertex buffer
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+  vec3 eye = -transpose(mat3(view)) * view[3].xyz;
+
+  // turns around y only, like the views it was baked from
+  vec3 to_eye = eye - instanceCenter.xyz;
+  to_eye.y = 0.0;
+  to_eye = dot(to_eye, to_eye) > 0.0 ? normalize(to_eye) : vec3(0.0, 0.0, 1.0);
+
+  vec3 up = vec3(0.0, 1.0, 0.0);
+  vec3 right = cross(-to_eye, up);
+
+  float angle = atan(to_eye.x, to_eye.z) - instanceYaw;
+  float column = mod(round(angle / (kTwoPi / atlas_grid.x)), atlas_grid.x);
+
+  uv = (vec2(column, instanceOrigin.w) + corner * 0.5 + 0.5) / atlas_grid;
+
+  float distance = length(instanceOrigin.xyz - eye);
+  fade = clamp(
+    (distance - fade_range.x) / max(fade_range.y - fade_range.x, 0.0001), 
+    0.0, 
+    1.0
+  );
+
+  vec3 position = 
+    instanceCenter.xyz + (right * corner.x + up * corner.y) * instanceCenter.w;
+
+  gl_Position = viewProjection * vec4(position, 1.0);
+}
@@ -1,9 +1,14 @@
 #version 330 core
 
+flat in uint material;
+
 out vec4 fragColor;
 
-uniform vec3 base_color;
+// kMaxMaterials entries, filled once as models load
+layout (std140) uniform MaterialPalette {
+  vec4 palette[256];
+};
 
 void main() {
-  fragColor = vec4(base_color, 1.0);
+  fragColor = vec4(palette[material].rgb, 1.0);
 }
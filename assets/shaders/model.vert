@@ -1,9 +1,22 @@
 #version 330 core
+// 16 bit fractions of the mesh's box when the arena quantizes vertices
 layout (location = 0) in vec3 vertexPosition;
+layout (location = 5) in uint vertexMaterial;
+
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
 
 uniform mat4 model;
-uniform mat4 viewProjection;
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+flat out uint material;
 
 void main() {
-  gl_Position = viewProjection * model * vec4(vertexPosition, 1.0);
+  material = vertexMaterial;
+  vec3 position = position_offset + vertexPosition * position_scale;
+  gl_Position = viewProjection * model * vec4(position, 1.0);
 }
@@ -0,0 +1,33 @@
+#version 430 core
+// still quantized, the object transforms already include each asset's
+// dequantize matrix since one draw spans many assets
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 5) in uint vertexMaterial;
+// visible object written by the cull pass, stepped per instance and
+// offset by each draw command's base instance
+layout (location = 6) in uint objectIndex;
+
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
+
+struct IndirectObject {
+  mat4 transform;
+  vec4 sphere;
+  uint first_draw;
+  uint draw_count;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+  IndirectObject objects[];
+};
+
+flat out uint material;
+
+void main() {
+  material = vertexMaterial;
+  gl_Position = 
+    viewProjection * objects[objectIndex].transform * vec4(vertexPosition, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+in float fade;
+flat in uint material;
+
+out vec4 fragColor;
+
+// kMaxMaterials entries, filled once as models load
+layout (std140) uniform MaterialPalette {
+  vec4 palette[256];
+};
+
+const float kBayer[16] = float[](
+  0.0, 8.0, 2.0, 10.0,
+  12.0, 4.0, 14.0, 6.0,
+  3.0, 11.0, 1.0, 9.0,
+  15.0, 7.0, 13.0, 5.0
+);
+
+void main() {
+  ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+  float threshold = (kBayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+
+  // impostor.frag keeps exactly the pixels dropped here
+  if (fade > threshold) {
+    discard;
+  }
+
+  fragColor = vec4(palette[material].rgb, 1.0);
+}
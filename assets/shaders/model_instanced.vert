@@ -0,0 +1,40 @@
+#version 330 core
+// 16 bit fractions of the mesh's box when the arena quantizes vertices
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 1) in mat4 instanceModel;
+layout (location = 5) in uint vertexMaterial;
+
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
+
+// distances over which the mesh hands over to its impostor, both zero
+// when the asset doesn't have one
+uniform vec2 fade_range;
+
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+out float fade;
+flat out uint material;
+
+void main() {
+  material = vertexMaterial;
+
+  vec3 eye = -transpose(mat3(view)) * view[3].xyz;
+  float distance = length(instanceModel[3].xyz - eye);
+
+  fade = 0.0;
+  if (fade_range.y > fade_range.x) {
+    fade = clamp(
+      (distance - fade_range.x) / (fade_range.y - fade_range.x), 
+      0.0, 
+      1.0
+    );
+  }
+
+  vec3 position = position_offset + vertexPosition * position_scale;
+  gl_Position = viewProjection * instanceModel * vec4(position, 1.0);
+}
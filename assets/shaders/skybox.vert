@@ -2,15 +2,18 @@
 
 layout (location = 0) in vec3 vertexPosition;
 
-uniform mat4 matProjection;
-uniform mat4 matView;
+layout (std140) uniform CameraMatrices {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+};
 
 out vec3 fragPosition;
 
 void main() {
   fragPosition = vertexPosition; 
 
-  mat4 rot_view = mat4(mat3(matView));
-  vec4 pos = matProjection * rot_view * vec4(vertexPosition, 1.0);
+  mat4 rot_view = mat4(mat3(view));
+  vec4 pos = projection * rot_view * vec4(vertexPosition, 1.0);
   gl_Position = pos.xyww;
 }
@@ -0,0 +1,238 @@
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/PhysicsWorld.h"
+
+// Steps a generated level of static blocks with the player walking across
+// it and a few dynamic bodies falling onto it, once with a body per block
+// and once with the blocks merged into chunked compounds. Then steps
+// levels full of falling crates on different thread counts, all on the
+// multithreaded world so one thread is a fair baseline.
+
+constexpr int kBenchSteps = 300;
+constexpr int kDynamicBodies = 64;
+constexpr float kBenchTimestep = 1.f / 60.f;
+// crates per stack, stacks are spread out so they settle as separate
+// islands the way scattered props do
+constexpr int kStackHeight = 8;
+
+struct BenchResult {
+  double setup_ms_;
+  double step_ms_;
+  int proxies_;
+};
+
+static const BenchResult RunStaticWorld(int block_count, bool merged) {
+  using Clock = std::chrono::steady_clock;
+
+  PhysicsWorld world;
+  btCollisionShape* block = world.GetAssetBoxShape(0, { 1.0, 1.0, 1.0 });
+
+  // a square field with some height variation, like a generated level
+  int side = (int)ceilf(sqrtf((float)block_count));
+  std::vector<StaticObject> objects;
+  for (int i = 0; i < block_count; ++i) {
+    int x = i % side;
+    int z = i / side;
+    objects.push_back(StaticObject {
+      .shape_ = block,
+      .position_ = { (float)x, (float)((x * 7 + z * 13) % 3) * 0.5f, (float)z },
+      .rotation_ = QuaternionIdentity()
+    });
+  }
+
+  Clock::time_point setup_start = Clock::now();
+
+  std::vector<RigidBody> bodies;
+  if (merged) {
+    world.BuildStaticWorld(objects);
+  } else {
+    for (const StaticObject& object : objects) {
+      bodies.push_back(world.CreateRigidBody(
+        object.position_,
+        object.shape_,
+        object.rotation_,
+        0.f
+      ));
+    }
+  }
+
+  double setup_ms = std::chrono::duration<double, std::milli>(
+    Clock::now() - setup_start
+  ).count();
+
+  std::unique_ptr<btCollisionShape> sphere = world.CreateSphereShape(0.25f);
+  std::vector<RigidBody> dynamic_bodies;
+  for (int i = 0; i < kDynamicBodies; ++i) {
+    Vector3 position = {
+      (float)(i % 8) * side / 8.f,
+      4.f + (float)(i / 8),
+      (float)(i / 8) * side / 8.f
+    };
+    dynamic_bodies.push_back(
+      world.CreateRigidBody(position, sphere.get(), QuaternionIdentity(), 1.f)
+    );
+  }
+
+  CharacterController player = world.CreateController(
+    0.25,
+    1.5,
+    0.1,
+    { 0.5f, 3.f, 0.5f }
+  );
+  player.controller_->setWalkDirection(btVector3(0.05, 0.0, 0.05));
+
+  Clock::time_point step_start = Clock::now();
+  for (int i = 0; i < kBenchSteps; ++i) {
+    world.Update(kBenchTimestep);
+  }
+  double step_ms = std::chrono::duration<double, std::milli>(
+    Clock::now() - step_start
+  ).count();
+
+  BenchResult result {
+    .setup_ms_ = setup_ms,
+    .step_ms_ = step_ms / kBenchSteps,
+    .proxies_ = merged ? world.GetStaticChunkCount() : (int)bodies.size()
+  };
+
+  world.ReleaseController(&player);
+  for (RigidBody& body : dynamic_bodies) {
+    world.ReleaseBody(&body);
+  }
+  for (RigidBody& body : bodies) {
+    world.ReleaseBody(&body);
+  }
+  world.ClearStaticWorld();
+
+  return result;
+}
+
+// average step time in milliseconds
+static const double RunDynamicStress(int crate_count, int thread_count) {
+  using Clock = std::chrono::steady_clock;
+
+  PhysicsWorld world(thread_count, true);
+
+  std::unique_ptr<btCollisionShape> ground = world.CreateBoxShape({ 
+    1000.0, 
+    1.0, 
+    1000.0 
+  });
+  RigidBody ground_body = world.CreateRigidBody(
+    { 0.f, -0.5f, 0.f },
+    ground.get(),
+    QuaternionIdentity(),
+    0.f
+  );
+
+  std::unique_ptr<btCollisionShape> crate = world.CreateBoxShape({ 
+    0.5, 
+    0.5, 
+    0.5 
+  });
+
+  int stack_count = crate_count / kStackHeight;
+  int side = (int)ceilf(sqrtf((float)stack_count));
+
+  std::vector<RigidBody> crates;
+  for (int i = 0; i < crate_count; ++i) {
+    int stack = i / kStackHeight;
+    int level = i % kStackHeight;
+
+    // a little offset per level so the stacks topple
+    Vector3 position = {
+      (float)(stack % side) * 2.f + level * 0.05f,
+      0.3f + level * 0.55f,
+      (float)(stack / side) * 2.f
+    };
+    crates.push_back(
+      world.CreateRigidBody(position, crate.get(), QuaternionIdentity(), 1.f)
+    );
+  }
+
+  Clock::time_point step_start = Clock::now();
+  for (int i = 0; i < kBenchSteps; ++i) {
+    world.Update(kBenchTimestep);
+  }
+  double step_ms = std::chrono::duration<double, std::milli>(
+    Clock::now() - step_start
+  ).count();
+
+  for (RigidBody& body : crates) {
+    world.ReleaseBody(&body);
+  }
+  world.ReleaseBody(&ground_body);
+
+  return step_ms / kBenchSteps;
+}
+
+int main() {
+  printf(
+    "%8s  %-10s  %8s  %10s  %10s\n",
+    "blocks",
+    "static",
+    "proxies",
+    "setup ms",
+    "step ms"
+  );
+
+  for (int block_count : { 1000, 2500, 5000, 10000 }) {
+    for (bool merged : { false, true }) {
+      BenchResult result = RunStaticWorld(block_count, merged);
+      printf(
+        "%8d  %-10s  %8d  %10.2f  %10.3f\n",
+        block_count,
+        merged ? "chunked" : "per-block",
+        result.proxies_,
+        result.setup_ms_,
+        result.step_ms_
+      );
+    }
+  }
+
+  int hardware_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+
+  std::vector<int> thread_counts;
+  for (int thread_count = 1; thread_count < hardware_threads; thread_count *= 2) {
+    thread_counts.push_back(thread_count);
+  }
+  thread_counts.push_back(hardware_threads);
+
+  printf(
+    "\n%8s  %8s  %10s  %8s\n",
+    "crates",
+    "threads",
+    "step ms",
+    "speedup"
+  );
+
+  for (int crate_count : { 1000, 4000, 8000 }) {
+    double single_ms = 0.0;
+
+    for (int thread_count : thread_counts) {
+      double step_ms = RunDynamicStress(crate_count, thread_count);
+      if (thread_count == 1) {
+        single_ms = step_ms;
+      }
+
+      printf(
+        "%8d  %8d  %10.3f  %7.2fx\n",
+        crate_count,
+        thread_count,
+        step_ms,
+        single_ms / step_ms
+      );
+    }
+  }
+
+  return 0;
+}
@@ -2,21 +2,42 @@
 #include <raylib.h>
 #include <raylib-physfs.h>
 
+#include "src/CameraUniforms.h"
+#include "src/Culling.h"
+#include "src/DebugDraw.h"
 #include "src/Game.h"
+#include "src/ImpostorRenderer.h"
+#include "src/IndirectRenderer.h"
+#include "src/InstancedRenderer.h"
 #include "src/FlyCamera.h"
 #include "src/LevelEditor.h"
+#include "src/OcclusionCuller.h"
+#include "src/RenderQueue.h"
 #include "src/Skybox.h"
+#include "src/StaticBatch.h"
+#include "src/ThreadPool.h"
 
 int main(void) {
 
   constexpr bool kIsGameOnly = true;
+  // level meshes merged per chunk while playing, the editor draws them live
+  constexpr bool kUseStaticBatching = true;
+  // on GL 4.3 contexts level meshes are culled and drawn from the GPU instead
+  constexpr bool kUseIndirectDrawing = true;
+  // foliage and props dither into their impostors between these distances
+  constexpr float kImpostorFadeStartDistance = 25.f;
+  constexpr float kImpostorFadeEndDistance = 30.f;
 
   ConfigFlags flags;
 
   int window_width = 0;
   int window_height = 0;
 
-  SetConfigFlags(ConfigFlags::FLAG_BORDERLESS_WINDOWED_MODE);
+  // gameplay runs on fixed ticks, so the frame rate is left to the display
+  SetConfigFlags(
+    ConfigFlags::FLAG_BORDERLESS_WINDOWED_MODE | 
+    ConfigFlags::FLAG_VSYNC_HINT
+  );
   InitWindow(window_width, window_height, "Galaxy Stride");
 
   SetTraceLogLevel(LOG_FATAL);
@@ -36,12 +57,15 @@ int main(void) {
 
   Skybox skybox;
 
+  CameraUniforms camera_uniforms;
+
   FlyCamera camera({ 0.0, 2.0, -5.0 }, 0.1, 5.0);
   camera.GetCamera().SetYaw(90.0);
 
-  SetTargetFPS(120); 
-
-  LevelEditor level_editor;
+  // players who never open the editor only pay for the current level's models
+  LevelEditor level_editor(
+    kIsGameOnly ? AssetResidency::kLevel : AssetResidency::kAll
+  );
 
   //level_editor.UpdateThumbnails();
 
@@ -78,19 +102,27 @@ int main(void) {
     game.NextLevel().c_str()
   );
 
-  Shader custom_model_shader = LoadShaderFromPhysFS(
-    "assets/shaders/model.vert", 
-    "assets/shaders/model.frag"
+  InstancedRenderer instanced_renderer;
+  ImpostorRenderer impostor_renderer(level_editor);
+  impostor_renderer.SetFadeDistances(
+    kImpostorFadeStartDistance, 
+    kImpostorFadeEndDistance
   );
+  StaticBatch static_batch;
+  IndirectRenderer indirect_renderer;
 
-  int custom_model_uniform_model = 
-    GetShaderLocation(custom_model_shader, "model");
+  bool use_indirect = kUseIndirectDrawing && indirect_renderer.IsSupported();
 
-  int custom_model_uniform_view_projection = 
-    GetShaderLocation(custom_model_shader, "viewProjection");
+  RenderQueue render_queue;
+  DebugDraw debug_draw;
+  bool show_physics = false;
 
-  int custom_model_uniform_base_color = 
-    GetShaderLocation(custom_model_shader, "base_color");  
+  ViewCuller culler;
+  bool show_culling_stats = false;
+
+  // rasterizes occluders while the game updates
+  ThreadPool frame_workers(1);
+  OcclusionCuller occlusion_culler;
  
   while (!WindowShouldClose()) { 
 
@@ -125,6 +157,16 @@ int main(void) {
       );
       max_score += game.GetCoins().size();
       game.Setup(level_editor);
+      if (use_indirect) {
+        indirect_renderer.Build(
+          level_editor, 
+          game.GetMeshes(), 
+          impostor_renderer
+        );
+      } else if (kUseStaticBatching) {
+        static_batch.Build(level_editor, game.GetMeshes(), impostor_renderer);
+      }
+      occlusion_culler.SetOccluders(level_editor, game.GetMeshes());
     } else if (game.GetFlag().is_touched_ && !kIsGameOnly) {
       is_play_mode = false;
       create_collision = true;
@@ -149,12 +191,43 @@ int main(void) {
       ToggleFullscreen();
     }
 
+    if (IsKeyPressed(KEY_F4)) {
+      culler.SetEnabled(!culler.IsEnabled());
+    }
+
+    if (IsKeyPressed(KEY_F5)) {
+      show_culling_stats = !show_culling_stats;
+    }
+
+    if (IsKeyPressed(KEY_F6)) {
+      occlusion_culler.SetEnabled(!occlusion_culler.IsEnabled());
+    }
+
+    if (IsKeyPressed(KEY_F7)) {
+      show_physics = !show_physics;
+    }
+
     if (is_play_mode && create_collision) {
       create_collision = false;
       game.Setup(level_editor);
+      if (use_indirect) {
+        indirect_renderer.Build(
+          level_editor, 
+          game.GetMeshes(), 
+          impostor_renderer
+        );
+      } else if (kUseStaticBatching) {
+        static_batch.Build(level_editor, game.GetMeshes(), impostor_renderer);
+      }
+      occlusion_culler.SetOccluders(level_editor, game.GetMeshes());
     }
 
 
+    // last frame's camera, the update hasn't moved it yet
+    if (is_play_mode) {
+      occlusion_culler.Begin(frame_workers, game.GetFlyCamera().GetCamera());
+    }
+
     if (is_play_mode && !menu) {
       game.Update(level_editor);
     }
@@ -179,11 +252,17 @@ int main(void) {
 
     Camera main_camera = 
       is_play_mode ? game.GetCamera() : camera.GetCamera().GetCamera();
+
+    FlyCamera& view_camera = is_play_mode ? game.GetFlyCamera() : camera;
+
+    // before the camera block is filled in for the frame, baking borrows it
+    impostor_renderer.Bake(level_editor, camera_uniforms);
+    camera_uniforms.Update(view_camera.GetCamera());
   
     BeginMode3D(main_camera); 
  
     if (!is_play_mode) {
-      level_editor.PlacePlayer(camera);
+      level_editor.PlacePlayer(camera, debug_draw);
     
       DrawGrid(20, 1.0);
 
@@ -196,9 +275,11 @@ int main(void) {
         );
 
         for (LevelMesh& mesh : game.GetMeshes()) {
-          level_editor.SelectObject(mesh, camera);
+          level_editor.SelectObject(mesh, camera, debug_draw);
         }
       }
+
+      level_editor.DrawMeshBounds(game.GetMeshes(), debug_draw);
     }
 
     /*
@@ -211,55 +292,111 @@ int main(void) {
 
     /*
     for (const LevelMesh& mesh : game.GetMeshes()) {
-      level_editor.DrawAsset(mesh, is_play_mode);
+      level_editor.DrawAsset(mesh, is_play_mode, debug_draw);
     }
     */
 
-    for (const LevelCoin& coin : game.GetCoins()) { 
-      if (!coin.collected_) {
-        level_editor.GetAsset(coin.index_).model_.DrawCustomModel(
-          game.GetFlyCamera(),
-          custom_model_shader,
-          custom_model_uniform_model,
-          custom_model_uniform_view_projection,
-          custom_model_uniform_base_color,
-          coin.pos_,
-          coin.rotation_
-        );
+    // after the editor has had its chance to move things this frame
+    game.UpdateTransforms(!is_play_mode);
+    const TransformCache& coin_transforms = game.GetCoinTransforms();
+    const TransformCache& mesh_transforms = game.GetMeshTransforms();
+
+    instanced_renderer.Clear();
+    culler.Begin(view_camera);
+    occlusion_culler.Wait(view_camera.GetCamera());
+
+    for (int i = 0; i < game.GetCoins().size(); ++i) { 
+      const LevelCoin& coin = game.GetCoins()[i];
+      const BoundingBox& bounds = 
+        level_editor.GetAsset(coin.index_).model_.GetBoundingBox();
+
+      if (
+        !coin.collected_ && 
+        culler.IsVisible(bounds, coin.pos_, coin.rotation_) &&
+        occlusion_culler.IsVisible(bounds, coin.pos_, coin.rotation_)
+      ) {
+        instanced_renderer.Add(coin.index_, coin_transforms.GetMatrix(i));
       }
     }
 
+    impostor_renderer.Clear();
+    Vector3 eye = view_camera.GetCamera().GetPosition();
+
+    bool draw_indirect = use_indirect && is_play_mode;
+    bool use_static_batch = 
+      kUseStaticBatching && is_play_mode && !draw_indirect;
+
+    for (int i = 0; i < game.GetMeshes().size(); ++i) { 
+      const LevelMesh& mesh = game.GetMeshes()[i];
+      if (
+        (draw_indirect && indirect_renderer.IsBatched(mesh.index_)) ||
+        (use_static_batch && static_batch.IsBatched(mesh.index_))
+      ) {
+        continue;
+      }
+
+      const BoundingBox& bounds = 
+        level_editor.GetAsset(mesh.index_).model_.GetBoundingBox();
+
+      if (
+        !culler.IsVisible(bounds, mesh.pos_, mesh.rotation_) ||
+        !occlusion_culler.IsVisible(bounds, mesh.pos_, mesh.rotation_)
+      ) {
+        continue;
+      }
 
-    for (const LevelMesh& mesh : game.GetMeshes()) { 
-      level_editor.GetAsset(mesh.index_).model_.DrawCustomModel(
-        game.GetFlyCamera(),
-        custom_model_shader,
-        custom_model_uniform_model,
-        custom_model_uniform_view_projection,
-        custom_model_uniform_base_color,
-        mesh.pos_,
-        mesh.rotation_
+      bool is_impostor_only = impostor_renderer.Add(
+        mesh.index_, 
+        bounds, 
+        mesh.pos_, 
+        mesh.rotation_, 
+        eye
       );
-    }
 
+      if (!is_impostor_only) {
+        instanced_renderer.Add(mesh.index_, mesh_transforms.GetMatrix(i));
+      }
+    }
 
-    if (!level_editor.IsFlagMode()) {
-      //level_editor.DrawFlag(game.GetFlag());
-      ModelComponent& flag = level_editor.GetAsset(kFlagModelIndex).model_;
-      level_editor.GetAsset(kFlagModelIndex).model_.DrawCustomModel(
-        game.GetFlyCamera(),
-        custom_model_shader,
-        custom_model_uniform_model,
-        custom_model_uniform_view_projection,
-        custom_model_uniform_base_color,
+    if (
+      !level_editor.IsFlagMode() &&
+      culler.IsVisible(
+        level_editor.GetAsset(kFlagModelIndex).model_.GetBoundingBox(),
         game.GetFlag().flag_position_,
         game.GetFlag().flag_rotation_
+      )
+    ) {
+      //level_editor.DrawFlag(game.GetFlag());
+      instanced_renderer.Add(kFlagModelIndex, game.GetFlagTransform());
+    }
+
+    render_queue.Clear();
+
+    instanced_renderer.Enqueue(
+      render_queue, 
+      level_editor, 
+      view_camera, 
+      impostor_renderer
+    );
+    impostor_renderer.Enqueue(render_queue);
+    if (draw_indirect) {
+      indirect_renderer.Enqueue(
+        render_queue, 
+        culler, 
+        occlusion_culler, 
+        view_camera
       );
+    } else if (use_static_batch) {
+      static_batch.Enqueue(render_queue, culler, occlusion_culler, eye);
     }
+    skybox.Enqueue(render_queue);
 
-    rlDisableBackfaceCulling();
-    skybox.Draw(is_play_mode ? game.GetFlyCamera() : camera);
-    rlEnableBackfaceCulling();
+    render_queue.Submit();
+
+    if (show_physics && is_play_mode) {
+      game.DrawPhysics(debug_draw);
+    }
+    debug_draw.Flush();
  
     EndMode3D();
 
@@ -288,6 +425,18 @@ int main(void) {
       game.DrawUI();
     }
 
+    if (show_culling_stats) {
+      DrawCullingStats(culler);
+      DrawRenderQueueStats(render_queue);
+      DrawOcclusionStats(occlusion_culler);
+      DrawDebugDrawStats(debug_draw);
+      DrawTimestepStats(game.GetTimestep());
+      DrawVertexMemoryStats(level_editor.GetGeometryArena());
+      if (kUseStaticBatching && !use_indirect) {
+        DrawStaticBatchStats(static_batch);
+      }
+    }
+
     if (menu) {
       ShowCursor();
       DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), RAYWHITE);
@@ -12,6 +12,10 @@ CameraComponent::CameraComponent() {
   CalculateForward();
 
   right_ = Vector3CrossProduct(forward_, up_);
+
+  aspect_ = 0.0;
+  view_dirty_ = true;
+  projection_dirty_ = true;
 }
 
 
@@ -26,6 +30,10 @@ CameraComponent::CameraComponent(
   CalculateForward();
 
   right_ = Vector3CrossProduct(forward_, up_);
+
+  aspect_ = 0.0;
+  view_dirty_ = true;
+  projection_dirty_ = true;
 }
 
 void CameraComponent::CalculateForward() {
@@ -33,6 +41,7 @@ void CameraComponent::CalculateForward() {
   forward_.y = sinf(pitch_ * DEG2RAD);
   forward_.z = sinf(yaw_ * DEG2RAD) * cosf(pitch_ * DEG2RAD);
   forward_ = Vector3Normalize(forward_);
+  view_dirty_ = true;
 }
 
 const Vector3 CameraComponent::GetForward() const {
@@ -49,6 +58,7 @@ const Vector3 CameraComponent::GetPosition() const {
 
 void CameraComponent::SetPosition(Vector3 position) {
   position_ = position;
+  view_dirty_ = true;
 }
 
 const float CameraComponent::GetYaw() const {
@@ -87,5 +97,52 @@ const float CameraComponent::GetFOV() const {
 
 void CameraComponent::SetFOV(float fov) {
   fov_ = fov;
+  projection_dirty_ = true;
+}
+
+void CameraComponent::UpdateMatrices() {
+  float aspect = (float)GetScreenWidth() / (float)GetScreenHeight();
+
+  if (aspect != aspect_) {
+    aspect_ = aspect;
+    projection_dirty_ = true;
+  }
+
+  if (!view_dirty_ && !projection_dirty_) {
+    return;
+  }
+
+  if (view_dirty_) {
+    view_ = MatrixLookAt(position_, Vector3Add(position_, forward_), up_);
+  }
+
+  if (projection_dirty_) {
+    projection_ = MatrixPerspective(
+      fov_ * DEG2RAD, 
+      aspect_, 
+      kCameraNear, 
+      kCameraFar
+    );
+  }
+
+  view_projection_ = MatrixMultiply(view_, projection_);
+
+  view_dirty_ = false;
+  projection_dirty_ = false;
+}
+
+const Matrix& CameraComponent::GetView() {
+  UpdateMatrices();
+  return view_;
+}
+
+const Matrix& CameraComponent::GetProjection() {
+  UpdateMatrices();
+  return projection_;
+}
+
+const Matrix& CameraComponent::GetViewProjection() {
+  UpdateMatrices();
+  return view_projection_;
 }
 
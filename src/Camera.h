@@ -4,6 +4,9 @@
 #include <raylib.h>
 #include <raymath.h>
 
+constexpr float kCameraNear = 0.01f;
+constexpr float kCameraFar = 100.0f;
+
 class CameraComponent {
 public:
   CameraComponent();
@@ -25,8 +28,15 @@ public:
 
   const float GetFOV() const;
   void SetFOV(float fov);
+
+  // cached, only rebuilt after the camera moves, turns, zooms or the
+  // window changes aspect ratio
+  const Matrix& GetView();
+  const Matrix& GetProjection();
+  const Matrix& GetViewProjection();
 private:
   void CalculateForward();
+  void UpdateMatrices();
 private:
   Vector3 position_;
 
@@ -38,6 +48,15 @@ private:
 
   float yaw_;
   float pitch_;
+
+  float aspect_;
+
+  bool view_dirty_;
+  bool projection_dirty_;
+
+  Matrix view_;
+  Matrix projection_;
+  Matrix view_projection_;
 };
 
 #endif
@@ -0,0 +1,57 @@
+#include "CameraUniforms.h"
+
+#include <glad.h>
+
+#include <cstring>
+
+CameraUniforms::CameraUniforms() {
+  glGenBuffers(1, &ubo_);
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  glBindBufferBase(GL_UNIFORM_BUFFER, kCameraUniformBinding, ubo_);
+
+  uploaded_once_ = false;
+}
+
+CameraUniforms::~CameraUniforms() {
+  glDeleteBuffers(1, &ubo_);
+}
+
+void CameraUniforms::Update(CameraComponent& camera) {
+  Upload(Block {
+    .view_ = MatrixToFloatV(camera.GetView()),
+    .projection_ = MatrixToFloatV(camera.GetProjection()),
+    .view_projection_ = MatrixToFloatV(camera.GetViewProjection())
+  });
+}
+
+void CameraUniforms::Update(const Matrix& view, const Matrix& projection) {
+  Upload(Block {
+    .view_ = MatrixToFloatV(view),
+    .projection_ = MatrixToFloatV(projection),
+    .view_projection_ = MatrixToFloatV(MatrixMultiply(view, projection))
+  });
+}
+
+void CameraUniforms::Upload(const Block& block) {
+  // a still camera costs nothing, not even the buffer upload
+  if (uploaded_once_ && std::memcmp(&block, &uploaded_, sizeof(Block)) == 0) {
+    return;
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  uploaded_ = block;
+  uploaded_once_ = true;
+}
+
+void BindCameraUniformBlock(Shader shader) {
+  unsigned int block_index = glGetUniformBlockIndex(shader.id, "CameraMatrices");
+  if (block_index != GL_INVALID_INDEX) {
+    glUniformBlockBinding(shader.id, block_index, kCameraUniformBinding);
+  }
+}
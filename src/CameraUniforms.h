@@ -0,0 +1,39 @@
+#ifndef CAMERA_UNIFORMS_H_
+#define CAMERA_UNIFORMS_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include "Camera.h"
+
+// binding point of the CameraMatrices block shared by every shader
+constexpr int kCameraUniformBinding = 0;
+
+// Publishes the active camera's matrices once per frame through a uniform
+// buffer, so draws never have to upload view or projection themselves.
+class CameraUniforms {
+public:
+  CameraUniforms();
+  ~CameraUniforms();
+
+  void Update(CameraComponent& camera);
+  // for offscreen passes that render from somewhere other than a camera
+  void Update(const Matrix& view, const Matrix& projection);
+private:
+  struct Block {
+    float16 view_;
+    float16 projection_;
+    float16 view_projection_;
+  };
+
+  void Upload(const Block& block);
+
+  unsigned int ubo_;
+  Block uploaded_;
+  bool uploaded_once_;
+};
+
+// points the shader's CameraMatrices block at kCameraUniformBinding
+void BindCameraUniformBlock(Shader shader);
+
+#endif
@@ -0,0 +1,224 @@
+#include "CollisionBaker.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "MeshCache.h"
+
+struct CollisionRule {
+  const char* prefix_;
+  CollisionProfile profile_;
+};
+
+// first matching prefix wins, anything unlisted keeps its box
+static const CollisionRule kCollisionRules[] = {
+  { "blockSlope", kMeshCollision },
+  { "blockSnowSlope", kMeshCollision },
+  { "blockDirtRamp", kMeshCollision },
+  { "bridgeRamp", kMeshCollision },
+  { "blockCurve", kMeshCollision },
+  { "blockSnowCurve", kMeshCollision },
+  { "blockRounded", kMeshCollision },
+  { "blockSnowRounded", kMeshCollision },
+  { "blockHexagon", kMeshCollision },
+  { "blockSnowHexagon", kMeshCollision },
+  { "blockCorner", kMeshCollision },
+  { "blockSnowCorner", kMeshCollision },
+  { "blockCliff", kMeshCollision },
+  { "blockSnowCliff", kMeshCollision },
+
+  { "barrel", kHullCollision },
+  { "bomb", kHullCollision },
+  { "chest", kHullCollision },
+  { "crate", kHullCollision },
+  { "mushrooms", kHullCollision },
+  { "plant", kHullCollision },
+  { "rocks", kHullCollision },
+  { "stones", kHullCollision },
+  { "tree", kHullCollision },
+};
+
+const CollisionProfile GetCollisionProfile(const std::string& asset_name) {
+  for (const CollisionRule& rule : kCollisionRules) {
+    if (asset_name.rfind(rule.prefix_, 0) == 0) {
+      return rule.profile_;
+    }
+  }
+
+  return kBoxCollision;
+}
+
+const std::string GetCollisionCachePath(const std::string& asset_name) {
+  std::string name = std::filesystem::path(asset_name).stem().string();
+  return "cache/collision/" + name + ".gsb";
+}
+
+std::unique_ptr<CollisionShape> BakeBoxShape(Vector3 size) {
+  std::unique_ptr<CollisionShape> baked = std::make_unique<CollisionShape>();
+  baked->shape_ = std::make_unique<btBoxShape>(
+    btVector3(
+      size.x / 2.0,
+      size.y / 2.0,
+      size.z / 2.0
+    )
+  );
+  return baked;
+}
+
+std::unique_ptr<CollisionShape> BakeHullShape(const CustomGeometry& geometry) {
+  std::unique_ptr<CollisionShape> baked = std::make_unique<CollisionShape>();
+
+  // converted point by point, btScalar may be a double. then every point
+  // that isn't on the hull is dropped
+  std::unique_ptr<btConvexHullShape> hull = 
+    std::make_unique<btConvexHullShape>();
+  for (Vector3 position : geometry.positions_) {
+    hull->addPoint(btVector3(position.x, position.y, position.z), false);
+  }
+  hull->optimizeConvexHull();
+  hull->recalcLocalAabb();
+
+  baked->shape_ = std::move(hull);
+  return baked;
+}
+
+static const uint64_t HashGeometry(const CustomGeometry& geometry) {
+  uint64_t position_hash = HashBytes(
+    (const unsigned char*)geometry.positions_.data(),
+    sizeof(Vector3) * geometry.positions_.size()
+  );
+  uint64_t index_hash = HashBytes(
+    (const unsigned char*)geometry.indices_.data(),
+    sizeof(uint32_t) * geometry.indices_.size()
+  );
+
+  return position_hash ^ (index_hash * 1099511628211ull);
+}
+
+static const CollisionCacheHeader MakeCacheHeader(
+  uint64_t geometry_hash,
+  uint32_t bvh_size
+) {
+  return CollisionCacheHeader {
+    .magic_ = kCollisionCacheMagic,
+    .version_ = kCollisionCacheVersion,
+    .geometry_hash_ = geometry_hash,
+    .bullet_version_ = BT_BULLET_VERSION,
+    .scalar_size_ = sizeof(btScalar),
+    .bvh_size_ = bvh_size,
+    .padding_ = 0
+  };
+}
+
+static bool ReadCollisionCache(
+  const std::string& path,
+  uint64_t geometry_hash,
+  std::vector<BvhBlock>* bvh
+) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  CollisionCacheHeader header;
+  if (!file.read((char*)&header, sizeof(header))) {
+    return false;
+  }
+
+  CollisionCacheHeader expected = MakeCacheHeader(geometry_hash, header.bvh_size_);
+  if (
+    header.magic_ != expected.magic_ ||
+    header.version_ != expected.version_ ||
+    header.geometry_hash_ != expected.geometry_hash_ ||
+    header.bullet_version_ != expected.bullet_version_ ||
+    header.scalar_size_ != expected.scalar_size_ ||
+    header.bvh_size_ == 0
+  ) {
+    return false;
+  }
+
+  bvh->resize((header.bvh_size_ + sizeof(BvhBlock) - 1) / sizeof(BvhBlock));
+  return (bool)file.read((char*)bvh->data(), header.bvh_size_);
+}
+
+std::unique_ptr<CollisionShape> BakeMeshShape(
+  const std::string& asset_name,
+  const CustomGeometry& geometry
+) {
+  std::unique_ptr<CollisionShape> baked = std::make_unique<CollisionShape>();
+
+  // bullet only references the triangles, so they live with the shape.
+  // widened one by one when bullet is built with doubles
+  baked->vertices_.reserve(geometry.positions_.size() * 3);
+  for (Vector3 position : geometry.positions_) {
+    baked->vertices_.push_back(position.x);
+    baked->vertices_.push_back(position.y);
+    baked->vertices_.push_back(position.z);
+  }
+  baked->indices_.assign(geometry.indices_.cbegin(), geometry.indices_.cend());
+
+  baked->mesh_ = std::make_unique<btTriangleIndexVertexArray>(
+    baked->indices_.size() / 3,
+    baked->indices_.data(),
+    sizeof(int) * 3,
+    geometry.positions_.size(),
+    baked->vertices_.data(),
+    sizeof(btScalar) * 3
+  );
+
+  uint64_t geometry_hash = HashGeometry(geometry);
+  std::string cache_path = GetCollisionCachePath(asset_name);
+
+  if (ReadCollisionCache(cache_path, geometry_hash, &baked->bvh_)) {
+    btOptimizedBvh* bvh = (btOptimizedBvh*)btOptimizedBvh::deSerializeInPlace(
+      baked->bvh_.data(),
+      sizeof(BvhBlock) * baked->bvh_.size(),
+      false
+    );
+
+    if (bvh != nullptr) {
+      std::unique_ptr<btBvhTriangleMeshShape> shape =
+        std::make_unique<btBvhTriangleMeshShape>(baked->mesh_.get(), true, false);
+      // not owned by the shape, it points into bvh_
+      shape->setOptimizedBvh(bvh);
+
+      baked->shape_ = std::move(shape);
+      return baked;
+    }
+  }
+
+  // missing, stale or from another bullet build, so build it again
+  std::unique_ptr<btBvhTriangleMeshShape> shape =
+    std::make_unique<btBvhTriangleMeshShape>(baked->mesh_.get(), true, true);
+
+  btOptimizedBvh* bvh = shape->getOptimizedBvh();
+  uint32_t bvh_size = bvh->calculateSerializeBufferSize();
+
+  std::vector<BvhBlock> serialized(
+    (bvh_size + sizeof(BvhBlock) - 1) / sizeof(BvhBlock)
+  );
+
+  if (bvh->serializeInPlace(serialized.data(), bvh_size, false)) {
+    CollisionCacheHeader header = MakeCacheHeader(geometry_hash, bvh_size);
+
+    std::vector<unsigned char> data(sizeof(header) + bvh_size);
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + sizeof(header), serialized.data(), bvh_size);
+
+    if (!WriteMeshCache(cache_path, data)) {
+      std::cout << "WARNING: could not write " << cache_path << std::endl;
+    }
+  }
+
+  std::ostringstream collision_log;
+  collision_log << asset_name << ": collision "
+    << baked->indices_.size() / 3 << " triangles, bvh "
+    << bvh_size << " bytes";
+  AppendBakeLog(collision_log.str());
+
+  baked->shape_ = std::move(shape);
+  return baked;
+}
@@ -0,0 +1,76 @@
+#ifndef COLLISION_BAKER_H_
+#define COLLISION_BAKER_H_
+
+#include <raylib.h>
+#include <btBulletDynamicsCommon.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CustomModelLoader.h"
+
+// Baked collision format, one file per triangle mesh asset. The bvh is
+// bullet's own in-place serialization, so loading it is a read and a
+// pointer fix-up instead of a rebuild.
+//
+// [header][bvh]
+
+constexpr uint32_t kCollisionCacheMagic = 0x42435347; // "GSCB"
+constexpr uint32_t kCollisionCacheVersion = 1;
+
+struct CollisionCacheHeader {
+  uint32_t magic_;
+  uint32_t version_;
+  // of the triangles the bvh was built over
+  uint64_t geometry_hash_;
+
+  // the serialized layout changes with both of these
+  uint32_t bullet_version_;
+  uint32_t scalar_size_;
+
+  uint32_t bvh_size_;
+  uint32_t padding_;
+};
+
+enum CollisionProfile {
+  // the asset's bounds, cheapest and fine for anything boxy
+  kBoxCollision,
+  // small props, close enough and still convex
+  kHullCollision,
+  // slopes, curves and anything the player walks along the surface of
+  kMeshCollision
+};
+
+const CollisionProfile GetCollisionProfile(const std::string& asset_name);
+
+// bullet's in-place bvh has to start on a 16 byte boundary
+struct alignas(16) BvhBlock {
+  unsigned char bytes_[16];
+};
+
+// A shape together with everything bullet keeps raw pointers into. Never
+// moved once made, the triangle arrays and bvh are referenced in place.
+struct CollisionShape {
+  std::vector<btScalar> vertices_;
+  std::vector<int> indices_;
+  std::unique_ptr<btTriangleIndexVertexArray> mesh_;
+  std::vector<BvhBlock> bvh_;
+
+  // last, so it is destroyed before what it points into
+  std::unique_ptr<btCollisionShape> shape_;
+};
+
+std::unique_ptr<CollisionShape> BakeBoxShape(Vector3 size);
+std::unique_ptr<CollisionShape> BakeHullShape(const CustomGeometry& geometry);
+// reads the bvh from the asset's cache when it still matches the geometry,
+// otherwise builds it and writes the cache for next time
+std::unique_ptr<CollisionShape> BakeMeshShape(
+  const std::string& asset_name,
+  const CustomGeometry& geometry
+);
+
+const std::string GetCollisionCachePath(const std::string& asset_name);
+
+#endif
@@ -0,0 +1,146 @@
+#include "Culling.h"
+
+#include <cmath>
+
+static const Plane NormalizePlane(float a, float b, float c, float d) {
+  float length = sqrtf(a * a + b * b + c * c);
+  return Plane {
+    .normal_ = { a / length, b / length, c / length },
+    .distance_ = d / length
+  };
+}
+
+const Frustum ExtractFrustum(const Matrix& m) {
+  // rows of the combined matrix, see Gribb & Hartmann
+  Vector4 row_x = { m.m0, m.m4, m.m8, m.m12 };
+  Vector4 row_y = { m.m1, m.m5, m.m9, m.m13 };
+  Vector4 row_z = { m.m2, m.m6, m.m10, m.m14 };
+  Vector4 row_w = { m.m3, m.m7, m.m11, m.m15 };
+
+  Frustum frustum;
+
+  frustum.planes_[kLeftPlane] = NormalizePlane(
+    row_w.x + row_x.x, row_w.y + row_x.y, row_w.z + row_x.z, row_w.w + row_x.w
+  );
+  frustum.planes_[kRightPlane] = NormalizePlane(
+    row_w.x - row_x.x, row_w.y - row_x.y, row_w.z - row_x.z, row_w.w - row_x.w
+  );
+  frustum.planes_[kBottomPlane] = NormalizePlane(
+    row_w.x + row_y.x, row_w.y + row_y.y, row_w.z + row_y.z, row_w.w + row_y.w
+  );
+  frustum.planes_[kTopPlane] = NormalizePlane(
+    row_w.x - row_y.x, row_w.y - row_y.y, row_w.z - row_y.z, row_w.w - row_y.w
+  );
+  frustum.planes_[kNearPlane] = NormalizePlane(
+    row_w.x + row_z.x, row_w.y + row_z.y, row_w.z + row_z.z, row_w.w + row_z.w
+  );
+  frustum.planes_[kFarPlane] = NormalizePlane(
+    row_w.x - row_z.x, row_w.y - row_z.y, row_w.z - row_z.z, row_w.w - row_z.w
+  );
+
+  return frustum;
+}
+
+const BoundingBox TransformBoundingBox(
+  const BoundingBox& bounds,
+  Vector3 position,
+  Quaternion rotation
+) {
+  Vector3 center = Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5);
+  Vector3 extents = Vector3Scale(Vector3Subtract(bounds.max, bounds.min), 0.5);
+
+  Matrix r = QuaternionToMatrix(rotation);
+
+  center = Vector3Add(Vector3RotateByQuaternion(center, rotation), position);
+
+  Vector3 world_extents = {
+    fabsf(r.m0) * extents.x + fabsf(r.m4) * extents.y + fabsf(r.m8) * extents.z,
+    fabsf(r.m1) * extents.x + fabsf(r.m5) * extents.y + fabsf(r.m9) * extents.z,
+    fabsf(r.m2) * extents.x + fabsf(r.m6) * extents.y + fabsf(r.m10) * extents.z
+  };
+
+  return BoundingBox {
+    Vector3Subtract(center, world_extents),
+    Vector3Add(center, world_extents)
+  };
+}
+
+const bool IsBoxInFrustum(const Frustum& frustum, const BoundingBox& box) {
+  for (const Plane& plane : frustum.planes_) {
+    // corner furthest along the plane normal
+    Vector3 corner = {
+      plane.normal_.x >= 0.0f ? box.max.x : box.min.x,
+      plane.normal_.y >= 0.0f ? box.max.y : box.min.y,
+      plane.normal_.z >= 0.0f ? box.max.z : box.min.z
+    };
+
+    if (Vector3DotProduct(plane.normal_, corner) + plane.distance_ < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ViewCuller::ViewCuller() {
+  enabled_ = true;
+  drawn_count_ = 0;
+  culled_count_ = 0;
+}
+
+void ViewCuller::Begin(FlyCamera& camera) {
+  frustum_ = ExtractFrustum(camera.GetCamera().GetViewProjection());
+  drawn_count_ = 0;
+  culled_count_ = 0;
+}
+
+const bool ViewCuller::IsVisible(
+  const BoundingBox& bounds, 
+  Vector3 position, 
+  Quaternion rotation
+) {
+  if (
+    enabled_ && 
+    !IsBoxInFrustum(frustum_, TransformBoundingBox(bounds, position, rotation))
+  ) {
+    culled_count_ += 1;
+    return false;
+  }
+
+  drawn_count_ += 1;
+  return true;
+}
+
+void ViewCuller::SetEnabled(bool enabled) {
+  enabled_ = enabled;
+}
+
+const bool ViewCuller::IsEnabled() const {
+  return enabled_;
+}
+
+const Frustum& ViewCuller::GetFrustum() const {
+  return frustum_;
+}
+
+const int ViewCuller::GetDrawnCount() const {
+  return drawn_count_;
+}
+
+const int ViewCuller::GetCulledCount() const {
+  return culled_count_;
+}
+
+void DrawCullingStats(const ViewCuller& culler) {
+  DrawText(
+    TextFormat(
+      "CULLING: %s  DRAWN: %d  CULLED: %d", 
+      culler.IsEnabled() ? "ON" : "OFF",
+      culler.GetDrawnCount(), 
+      culler.GetCulledCount()
+    ),
+    20, 
+    130, 
+    24, 
+    YELLOW
+  );
+}
@@ -0,0 +1,71 @@
+#ifndef CULLING_H_
+#define CULLING_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include "FlyCamera.h"
+
+struct Plane {
+  Vector3 normal_;
+  float distance_;
+};
+
+enum FrustumPlane {
+  kLeftPlane,
+  kRightPlane,
+  kBottomPlane,
+  kTopPlane,
+  kNearPlane,
+  kFarPlane,
+  kPlaneCount
+};
+
+struct Frustum {
+  Plane planes_[kPlaneCount];
+};
+
+// planes point inwards, a point is inside when it is in front of all six
+const Frustum ExtractFrustum(const Matrix& view_projection);
+
+// world space box that encloses the local bounds once rotated and moved
+const BoundingBox TransformBoundingBox(
+  const BoundingBox& bounds,
+  Vector3 position,
+  Quaternion rotation
+);
+
+const bool IsBoxInFrustum(const Frustum& frustum, const BoundingBox& box);
+
+class ViewCuller {
+public:
+  ViewCuller();
+
+  // call once per frame before testing any objects
+  void Begin(FlyCamera& camera);
+
+  const bool IsVisible(
+    const BoundingBox& bounds, 
+    Vector3 position, 
+    Quaternion rotation
+  );
+
+  void SetEnabled(bool enabled);
+  const bool IsEnabled() const;
+
+  const Frustum& GetFrustum() const;
+
+  const int GetDrawnCount() const;
+  const int GetCulledCount() const;
+private:
+  Frustum frustum_;
+
+  bool enabled_;
+
+  int drawn_count_;
+  int culled_count_;
+};
+
+void DrawCullingStats(const ViewCuller& culler);
+
+#endif
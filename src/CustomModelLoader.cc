@@ -1,52 +1,301 @@
 #include "CustomModelLoader.h"
 
 #include <glad.h>
-#include <raylib-physfs.h>
+#include <physfs.h>
 #include <raymath.h>
+#include <tiny_gltf.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 
-void CustomModel::LoadFromMemory(const char* filename) {
-  CustomModel loaded_model {};
+#include "MappedFile.h"
+#include "TransformCache.h"
 
-  tinygltf::TinyGLTF loader;
-  unsigned int data_size = 0;
-  unsigned char* data = LoadFileDataFromPhysFS(
-    TextFormat("assets/models/%s", filename), &data_size
-  );
+// returns the bytes an accessor covers, or nullptr when they would run past
+// the end of its buffer
+static const unsigned char* GetAccessorData(
+  const tinygltf::Model& model,
+  const tinygltf::Accessor& accessor,
+  size_t element_size,
+  size_t* stride
+) {
+  if (accessor.bufferView < 0 || accessor.sparse.isSparse) {
+    return nullptr;
+  }
 
-  tinygltf::Model model;
-  std::string error, warning;
-  loader.LoadBinaryFromMemory(&model, &error, &warning, data, data_size);
+  const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers[view.buffer];
 
-  if (!error.empty()) {
-    std::cout << "ERROR: " << error << std::endl;
+  *stride = view.byteStride != 0 ? view.byteStride : element_size;
+
+  size_t offset = view.byteOffset + accessor.byteOffset;
+  size_t last = offset + *stride * (accessor.count - 1) + element_size;
+
+  if (
+    accessor.count == 0 ||
+    *stride < element_size ||
+    accessor.byteOffset + element_size > view.byteLength ||
+    last > view.byteOffset + view.byteLength ||
+    last > buffer.data.size()
+  ) {
+    return nullptr;
   }
-  if (!warning.empty()) {
-    std::cout << warning << std::endl;
+
+  return &buffer.data[offset];
+}
+
+static bool ReadPositions(
+  const tinygltf::Model& model,
+  const tinygltf::Accessor& accessor,
+  std::vector<Vector3>& positions
+) {
+  if (
+    accessor.type != TINYGLTF_TYPE_VEC3 ||
+    accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT
+  ) {
+    return false;
+  }
+
+  size_t stride = 0;
+  const unsigned char* data = 
+    GetAccessorData(model, accessor, sizeof(Vector3), &stride);
+  if (data == nullptr) {
+    return false;
+  }
+
+  positions.resize(accessor.count);
+  for (size_t i = 0; i < accessor.count; ++i) {
+    memcpy(&positions[i], data + stride * i, sizeof(Vector3));
   }
 
-  for (const tinygltf::Node& node : model.nodes) {
-    ProcessNodes(node, model);
-    for (const int& child : node.children) {
-      ProcessNodes(model.nodes[child], model);
+  return true;
+}
+
+template<typename T>
+static void ReadIndexData(
+  const unsigned char* data, 
+  size_t stride, 
+  std::vector<uint32_t>& indices
+) {
+  for (size_t i = 0; i < indices.size(); ++i) {
+    T index;
+    memcpy(&index, data + stride * i, sizeof(T));
+    indices[i] = index;
+  }
+}
+
+static bool ReadIndices(
+  const tinygltf::Model& model,
+  const tinygltf::Primitive& primitive,
+  uint32_t vertex_count,
+  std::vector<uint32_t>& indices
+) {
+  // non-indexed primitives draw their vertices in order
+  if (primitive.indices < 0) {
+    indices.resize(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      indices[i] = i;
     }
-  }  
+    return true;
+  }
+
+  const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
+  if (accessor.type != TINYGLTF_TYPE_SCALAR) {
+    return false;
+  }
+
+  size_t element_size = 0;
+  switch (accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      element_size = sizeof(uint8_t);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      element_size = sizeof(uint16_t);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      element_size = sizeof(uint32_t);
+      break;
+    default:
+      return false;
+  }
+
+  size_t stride = 0;
+  const unsigned char* data = 
+    GetAccessorData(model, accessor, element_size, &stride);
+  if (data == nullptr) {
+    return false;
+  }
+
+  indices.resize(accessor.count);
+  switch (element_size) {
+    case sizeof(uint8_t):
+      ReadIndexData<uint8_t>(data, stride, indices);
+      break;
+    case sizeof(uint16_t):
+      ReadIndexData<uint16_t>(data, stride, indices);
+      break;
+    default:
+      ReadIndexData<uint32_t>(data, stride, indices);
+      break;
+  }
+
+  for (uint32_t index : indices) {
+    if (index >= vertex_count) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// strips and fans become plain triangle lists, anything else is rejected
+static bool Triangulate(int mode, std::vector<uint32_t>& indices) {
+  if (mode == TINYGLTF_MODE_TRIANGLES || mode < 0) {
+    indices.resize(indices.size() - indices.size() % 3);
+    return true;
+  }
+
+  if (mode != TINYGLTF_MODE_TRIANGLE_STRIP && mode != TINYGLTF_MODE_TRIANGLE_FAN) {
+    return false;
+  }
+
+  std::vector<uint32_t> triangles;
+  for (size_t i = 2; i < indices.size(); ++i) {
+    if (mode == TINYGLTF_MODE_TRIANGLE_FAN) {
+      triangles.insert(triangles.end(), { 
+        indices[0], indices[i - 1], indices[i] 
+      });
+    } else if (i % 2 == 0) {
+      triangles.insert(triangles.end(), { 
+        indices[i - 2], indices[i - 1], indices[i] 
+      });
+    } else {
+      // keep the winding consistent on odd strip triangles
+      triangles.insert(triangles.end(), { 
+        indices[i - 1], indices[i - 2], indices[i] 
+      });
+    }
+  }
+
+  indices = std::move(triangles);
+  return true;
 }
 
-void CustomModel::ProcessNodes(
-  const tinygltf::Node& node, 
-  const tinygltf::Model& model
+// overdraw sorting is cheap next to the rest of the bake, but can be
+// switched off here if it ever costs more vertex cache than it saves
+constexpr bool kBakeReduceOverdraw = true;
+
+// grid cell size in model space units for each generated level of detail,
+// a scaled instance scales its cells with it
+constexpr float kLodCellSizes[kMaxMeshLods - 1] = { 0.04f, 0.12f };
+// a level is only kept when it has at most this much of the previous
+// level's triangles
+constexpr float kLodMinReduction = 0.75f;
+
+static void ProcessMesh(
+  const tinygltf::Mesh& mesh, 
+  const tinygltf::Model& model,
+  const Matrix& transform,
+  MeshOptimizeStats& stats,
+  MeshCacheWriter& writer
 ) {
+  writer.BeginMesh();
+
+  for (const tinygltf::Primitive& primitive : mesh.primitives) {
+    std::vector<double> base_color { 0.5, 0.0, 0.5 };
+
+    if (primitive.material >= 0) {
+      const tinygltf::Material& material = model.materials[primitive.material];
+      if (!material.pbrMetallicRoughness.baseColorFactor.empty()) {
+        base_color = material.pbrMetallicRoughness.baseColorFactor;
+      }
+    }
+
+    Vector3 base_color_mesh;
+
+    base_color_mesh.x = base_color[0];
+    base_color_mesh.y = base_color[1];
+    base_color_mesh.z = base_color[2];
+
+    auto position = primitive.attributes.find("POSITION");
+    if (position == primitive.attributes.end()) {
+      continue;
+    }
+
+    std::vector<Vector3> positions;
+    std::vector<uint32_t> indices;
+
+    if (
+      !ReadPositions(model, model.accessors[position->second], positions) ||
+      !ReadIndices(model, primitive, positions.size(), indices) ||
+      !Triangulate(primitive.mode, indices) ||
+      indices.empty()
+    ) {
+      std::cout << "WARNING: skipping primitive of " << mesh.name 
+        << " with a layout that can't be drawn" << std::endl;
+      continue;
+    }
+
+    for (Vector3& vertex : positions) {
+      vertex = Vector3Transform(vertex, transform);
+    }
+
+    stats.Add(OptimizeMesh(positions, indices, kBakeReduceOverdraw));
+
+    std::vector<MeshLod> lods;
+    lods.push_back(MeshLod { indices, 0.f });
+
+    // every level is simplified from the full mesh so errors don't stack
+    for (float cell_size : kLodCellSizes) {
+      MeshLod lod;
+      lod.error_ = SimplifyMesh(positions, indices, cell_size, lod.indices_);
+
+      if (lod.indices_.empty()) {
+        break;
+      }
+
+      // not worth a level of its own, a coarser grid may still be
+      if (lod.indices_.size() > lods.back().indices_.size() * kLodMinReduction) {
+        continue;
+      }
+
+      OptimizeVertexCache(lod.indices_, positions.size());
+      lods.push_back(std::move(lod));
+    }
+
+    writer.AddPrimitive(base_color_mesh, positions, lods);
+  }
+}
+
+static const Matrix GetLocalTransform(const tinygltf::Node& node) {
+  // glTF matrices are column major, same as raylib's m0..m15
+  if (node.matrix.size() == 16) {
+    float m[16];
+    for (int i = 0; i < 16; ++i) {
+      m[i] = node.matrix[i];
+    }
+
+    return Matrix {
+      m[0], m[4], m[8], m[12],
+      m[1], m[5], m[9], m[13],
+      m[2], m[6], m[10], m[14],
+      m[3], m[7], m[11], m[15]
+    };
+  }
+
   Matrix transform = MatrixIdentity();
 
-  if (node.translation.size() == 3) {
+  // raylib multiplies left to right, so this applies scale, rotation and
+  // then translation
+  if (node.scale.size() == 3) {
     transform = MatrixMultiply(
       transform, 
-      MatrixTranslate(
-        node.translation[0], 
-        node.translation[1], 
-        node.translation[2]
+      MatrixScale(
+        node.scale[0], 
+        node.scale[1], 
+        node.scale[2]
       )
     );
   }
@@ -65,266 +314,514 @@ void CustomModel::ProcessNodes(
     );
   }
 
-  if (node.scale.size() == 3) {
+  if (node.translation.size() == 3) {
     transform = MatrixMultiply(
       transform, 
-      MatrixScale(
-        node.scale[0], 
-        node.scale[1], 
-        node.scale[2]
+      MatrixTranslate(
+        node.translation[0], 
+        node.translation[1], 
+        node.translation[2]
       )
     );
   }
 
-  ProcessMesh(model.meshes[node.mesh], model, transform);
+  return transform;
 }
 
-void CustomModel::ProcessMesh(
-  const tinygltf::Mesh& mesh, 
+struct ImportedMesh {
+  int mesh_;
+  Matrix transform_;
+};
+
+struct SceneTraversal {
+  std::vector<bool> visited_;
+  // meshes already written, a second node placing the same mesh at the
+  // same spot is skipped instead of doubling its geometry
+  std::vector<ImportedMesh> imported_;
+
+  MeshOptimizeStats stats_;
+};
+
+static void ProcessNodes(
+  int node_index, 
+  const Matrix& parent_transform,
   const tinygltf::Model& model,
-  const Matrix& transform
+  SceneTraversal& traversal,
+  MeshCacheWriter& writer
 ) {
-  CustomMesh loaded_mesh;
-  loaded_mesh.transform_ = transform;
+  if (
+    node_index < 0 || 
+    node_index >= model.nodes.size() || 
+    traversal.visited_[node_index]
+  ) {
+    return;
+  }
+  traversal.visited_[node_index] = true;
+
+  const tinygltf::Node& node = model.nodes[node_index];
+  Matrix transform = MatrixMultiply(GetLocalTransform(node), parent_transform);
+
+  if (node.mesh >= 0 && node.mesh < model.meshes.size()) {
+    bool is_duplicate = false;
+    for (const ImportedMesh& imported : traversal.imported_) {
+      if (
+        imported.mesh_ == node.mesh &&
+        memcmp(&imported.transform_, &transform, sizeof(Matrix)) == 0
+      ) {
+        is_duplicate = true;
+        break;
+      }
+    }
 
-  for (const tinygltf::Primitive& primitive : mesh.primitives) {
-    const tinygltf::Material& material = model.materials[primitive.material];
+    if (!is_duplicate) {
+      traversal.imported_.push_back(ImportedMesh { node.mesh, transform });
+      ProcessMesh(
+        model.meshes[node.mesh], 
+        model, 
+        transform, 
+        traversal.stats_, 
+        writer
+      );
+    }
+  }
 
-    std::vector<double> base_color { 0.5, 0.0, 0.5 };
+  for (int child : node.children) {
+    ProcessNodes(child, transform, model, traversal, writer);
+  }
+}
+
+const std::vector<unsigned char> BakeModel(
+  const unsigned char* data, 
+  unsigned int data_size,
+  uint64_t source_hash,
+  MeshOptimizeStats* stats
+) {
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string error, warning;
+  loader.LoadBinaryFromMemory(&model, &error, &warning, data, data_size);
 
-    if (!material.pbrMetallicRoughness.baseColorFactor.empty()) {
-      base_color = material.pbrMetallicRoughness.baseColorFactor;
+  if (!error.empty()) {
+    std::cout << "ERROR: " << error << std::endl;
+  }
+  if (!warning.empty()) {
+    std::cout << warning << std::endl;
+  }
+
+  std::vector<int> roots;
+
+  if (!model.scenes.empty()) {
+    int scene = model.defaultScene >= 0 ? model.defaultScene : 0;
+    roots = model.scenes[scene].nodes;
+  } else {
+    // no scene, so every node that isn't someone's child is a root
+    std::vector<bool> is_child(model.nodes.size(), false);
+    for (const tinygltf::Node& node : model.nodes) {
+      for (int child : node.children) {
+        if (child >= 0 && child < is_child.size()) {
+          is_child[child] = true;
+        }
+      }
     }
 
-    Vector3 base_color_mesh;
+    for (int i = 0; i < model.nodes.size(); ++i) {
+      if (!is_child[i]) {
+        roots.push_back(i);
+      }
+    }
+  }
 
-    base_color_mesh.x = base_color[0];
-    base_color_mesh.y = base_color[1];
-    base_color_mesh.z = base_color[2];
+  SceneTraversal traversal;
+  traversal.visited_.resize(model.nodes.size(), false);
 
-    loaded_mesh.base_color_.push_back(base_color_mesh);
+  MeshCacheWriter writer;
 
-    const tinygltf::Accessor& indices_accessor = 
-      model.accessors[primitive.indices];
+  for (int root : roots) {
+    ProcessNodes(root, MatrixIdentity(), model, traversal, writer);
+  }
 
-    loaded_mesh.index_count_.push_back(indices_accessor.count);
+  if (stats != nullptr) {
+    *stats = traversal.stats_;
+  }
 
-    const tinygltf::BufferView& indices_view = 
-      model.bufferViews[indices_accessor.bufferView];
-    const tinygltf::Buffer& indices_buffer = 
-      model.buffers[indices_view.buffer];
+  return writer.Finish(source_hash);
+}
 
-    std::vector<unsigned char> indices_data(
-      indices_buffer.data.cbegin() + indices_view.byteOffset,
-      indices_buffer.data.cbegin() + 
-      indices_view.byteOffset + 
-      indices_view.byteLength
-    );
+static bool ReadModelFile(
+  const std::string& path, 
+  std::vector<unsigned char>& data
+) {
+  // straight physfs instead of LoadFileDataFromPhysFS, this runs on worker
+  // threads and physfs handles are safe to use from any thread
+  PHYSFS_File* file = PHYSFS_openRead(path.c_str());
+  if (file == nullptr) {
+    return false;
+  }
 
-    unsigned int vao = 0;
-    unsigned int vbo = 0;
-    unsigned int ebo = 0;
+  PHYSFS_sint64 length = PHYSFS_fileLength(file);
+  if (length <= 0) {
+    PHYSFS_close(file);
+    return false;
+  }
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+  data.resize(length);
+  PHYSFS_sint64 read = PHYSFS_readBytes(file, data.data(), length);
+  PHYSFS_close(file);
 
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(
-      GL_ELEMENT_ARRAY_BUFFER, 
-      indices_data.size(), 
-      &indices_data[0], 
-      GL_STATIC_DRAW
-    );
+  return read == length;
+}
 
-    for (auto attribute : primitive.attributes) {
-      if (attribute.first == "POSITION")  {
-        const tinygltf::Accessor& pos_accessor = 
-          model.accessors[attribute.second];
-
-        loaded_mesh.mins_.push_back
-        (
-          Vector3 
-          { 
-            (float)pos_accessor.minValues[0], 
-            (float)pos_accessor.minValues[1], 
-            (float)pos_accessor.minValues[2]
-          }
-        );
-
-      loaded_mesh.maxs_.push_back
-        (
-          Vector3 
-          { 
-            (float)pos_accessor.maxValues[0], 
-            (float)pos_accessor.maxValues[1], 
-            (float)pos_accessor.maxValues[2]
-          }
-        );
-
-
-        const tinygltf::BufferView& pos_view = 
-          model.bufferViews[pos_accessor.bufferView];
-
-        const tinygltf::Buffer& pos_buffer = 
-          model.buffers[pos_view.buffer];
-
-
-        std::vector<unsigned char> position(
-          pos_buffer.data.cbegin() + pos_view.byteOffset,
-          pos_buffer.data.cbegin() + 
-          pos_view.byteOffset + 
-          pos_view.byteLength
-        );
-
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(
-          GL_ARRAY_BUFFER,
-          position.size(),
-          &position[0],
-          GL_STATIC_DRAW
-        );
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
-        glEnableVertexAttribArray(0);
-      }
+static const BoundingBox ComputeBounds(const MeshCacheView& view) {
+  BoundingBox bounds = { 0 };
+
+  for (int i = 0; i < view.header_->primitive_count_; ++i) {
+    const MeshCachePrimitive& primitive = view.primitives_[i];
+    if (i == 0) {
+      bounds = { primitive.min_, primitive.max_ };
+    } else {
+      bounds.min = Vector3Min(bounds.min, primitive.min_);
+      bounds.max = Vector3Max(bounds.max, primitive.max_);
     }
+  }
+
+  return bounds;
+}
+
+// the source's hash combined with every setting that changes what a bake
+// writes, so editing one of them rebakes caches made with the old value
+static const uint64_t GetBakeKey(uint64_t source_hash) {
+  std::vector<float> settings = {
+    kBakeReduceOverdraw ? 1.f : 0.f,
+    kOverdrawThreshold,
+    (float)kAcmrCacheSize,
+    kLodMinReduction
+  };
+  settings.insert(
+    settings.end(), 
+    std::begin(kLodCellSizes), 
+    std::end(kLodCellSizes)
+  );
+
+  std::vector<unsigned char> key(
+    sizeof(source_hash) + sizeof(float) * settings.size()
+  );
+  memcpy(key.data(), &source_hash, sizeof(source_hash));
+  memcpy(
+    key.data() + sizeof(source_hash), 
+    settings.data(), 
+    sizeof(float) * settings.size()
+  );
 
-    
+  return HashBytes(key.data(), key.size());
+}
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+bool LoadModelData(const char* filename, ModelData* data) {
+  std::vector<unsigned char> source;
+  if (!ReadModelFile(std::string("assets/models/") + filename, source)) {
+    return false;
+  }
 
+  uint64_t source_hash = 
+    GetBakeKey(HashBytes(source.data(), source.size()));
+  std::string cache_path = GetMeshCachePath(filename);
+
+  if (
+    data->cache_file_.Open(cache_path.c_str()) &&
+    ViewMeshCache(
+      data->cache_file_.GetData(), 
+      data->cache_file_.GetSize(), 
+      source_hash, 
+      &data->view_
+    )
+  ) {
+    data->bounds_ = ComputeBounds(data->view_);
+    return data->valid_ = true;
+  }
 
-    loaded_mesh.vao_.push_back(vao);
-    loaded_mesh.vbo_.push_back(vbo);
-    loaded_mesh.ebo_.push_back(ebo);
+  // missing, stale or from an older format, so bake it again
+  data->cache_file_.Close();
+
+  MeshOptimizeStats stats;
+  data->baked_ = 
+    BakeModel(source.data(), source.size(), source_hash, &stats);
+
+  std::ostringstream bake_log;
+  bake_log << filename 
+    << ": vertices " << stats.vertices_before_ << " -> " << stats.vertices_after_ 
+    << ", triangles " << stats.triangles_
+    << ", ACMR " << stats.GetAcmrBefore() << " -> " << stats.GetAcmrAfter();
+  AppendBakeLog(bake_log.str());
+
+  // what the arena stores against plain float positions
+  std::ostringstream vertex_log;
+  vertex_log << filename << ": vertex memory " 
+    << kPositionVertexSize * stats.vertices_after_ << " bytes as float32, "
+    << kArenaVertexSize * stats.vertices_after_ << " bytes stored";
+  AppendBakeLog(vertex_log.str());
+
+  if (!WriteMeshCache(cache_path, data->baked_)) {
+    std::cout << "WARNING: could not write " << cache_path << std::endl;
   }
 
+  if (
+    !ViewMeshCache(
+      data->baked_.data(), 
+      data->baked_.size(), 
+      source_hash, 
+      &data->view_
+    )
+  ) {
+    return false;
+  }
 
-  meshes_.push_back(loaded_mesh);  
+  data->bounds_ = ComputeBounds(data->view_);
+  return data->valid_ = true;
 }
 
-void CustomModel::Unload() {
-  for (CustomMesh& mesh : meshes_)  {
-    for (int i = 0; i < mesh.vao_.size(); ++i) {
-      glDeleteVertexArrays(1, &mesh.vao_[i]);
-      glDeleteBuffers(1, &mesh.vbo_[i]);
-      glDeleteBuffers(1, &mesh.ebo_[i]);
-    } 
+void CustomModel::LoadFromMemory(
+  const char* filename, 
+  GeometryArena& arena, 
+  MaterialPalette& palette
+) {
+  ModelData data;
+  if (LoadModelData(filename, &data)) {
+    Upload(data, arena, palette);
+    palette.Upload();
+  }
+}
+
+static void AppendGeometry(
+  const MeshCacheView& view,
+  const MeshCachePrimitive& primitive,
+  uint32_t material,
+  CustomGeometry* geometry
+) {
+  uint32_t first_vertex = geometry->positions_.size();
+
+  geometry->positions_.resize(first_vertex + primitive.vertex_count_);
+  memcpy(
+    &geometry->positions_[first_vertex],
+    view.vertex_data_ + primitive.vertex_offset_,
+    sizeof(Vector3) * primitive.vertex_count_
+  );
+  geometry->materials_.resize(
+    geometry->positions_.size(), 
+    material
+  );
+
+  // only the full detail level, it is the first range of indices
+  const unsigned char* indices = 
+    view.index_data_ + primitive.index_offset_ + 
+    primitive.lods_[0].first_index_ * primitive.index_stride_;
+
+  for (int i = 0; i < primitive.lods_[0].index_count_; ++i) {
+    uint32_t index = 0;
+    if (primitive.index_stride_ == sizeof(uint16_t)) {
+      uint16_t short_index = 0;
+      memcpy(&short_index, indices + i * sizeof(uint16_t), sizeof(uint16_t));
+      index = short_index;
+    } else {
+      memcpy(&index, indices + i * sizeof(uint32_t), sizeof(uint32_t));
+    }
+
+    geometry->indices_.push_back(first_vertex + index);
   }
 }
 
+void CustomModel::Upload(
+  const ModelData& data, 
+  GeometryArena& arena, 
+  MaterialPalette& palette
+) {
+  if (!data.valid_) {
+    return;
+  }
+
+  const MeshCacheView& view = data.view_;
+  bounds_ = data.bounds_;
+  quantization_ = ::GetVertexQuantization(bounds_);
+  arena_ = &arena;
+
+  for (int i = 0; i < view.header_->mesh_count_; ++i) {
+    const MeshCacheMesh& cache_mesh = view.meshes_[i];
+
+    CustomMesh loaded_mesh;
+
+    for (int j = 0; j < cache_mesh.primitive_count_; ++j) {
+      const MeshCachePrimitive& primitive = 
+        view.primitives_[cache_mesh.first_primitive_ + j];
+
+      uint32_t material = palette.FindOrAdd(primitive.base_color_);
+
+      ArenaRange range = arena.Allocate(
+        view.vertex_data_ + primitive.vertex_offset_,
+        primitive.vertex_count_,
+        view.index_data_ + primitive.index_offset_,
+        primitive.index_size_,
+        material,
+        quantization_
+      );
+
+      AppendGeometry(view, primitive, material, &geometry_);
+
+      std::vector<CustomLod> lods;
+      for (int k = 0; k < primitive.lod_count_; ++k) {
+        const MeshCacheLod& lod = primitive.lods_[k];
+        lods.push_back(CustomLod {
+          .index_offset_ = 
+            range.index_offset_ + lod.first_index_ * primitive.index_stride_,
+          .index_count_ = (int)lod.index_count_
+        });
+
+        if (k >= lod_errors_.size()) {
+          lod_errors_.push_back(lod.error_);
+        } else {
+          lod_errors_[k] = std::max(lod_errors_[k], lod.error_);
+        }
+      }
+
+      loaded_mesh.index_type_.push_back(
+        primitive.index_stride_ == sizeof(uint16_t) ? 
+          GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+      );
+      loaded_mesh.ranges_.push_back(range);
+      loaded_mesh.lods_.push_back(lods);
+    }
+
+    meshes_.push_back(loaded_mesh);
+  }
+}
+
+void CustomModel::Unload() {
+  if (arena_ != nullptr) {
+    for (CustomMesh& mesh : meshes_)  {
+      for (const ArenaRange& range : mesh.ranges_) {
+        arena_->Free(range);
+      } 
+    }
+  }
+
+  meshes_.clear();
+  geometry_ = CustomGeometry();
+  lod_errors_.clear();
+  bounds_ = { 0 };
+  arena_ = nullptr;
+}
 
 void CustomModel::Draw(
-  FlyCamera& camera, 
   Shader shader,
   int model_matrix_loc,
-  int view_projection_loc,
-  int base_color_loc,
+  const QuantizationUniforms& quantization_uniforms,
   Vector3 position,
   Quaternion rotation,
   Vector3 scale
 ) {
-  Vector3 cam_position = camera.GetCamera().GetPosition();
-  Vector3 cam_forward = camera.GetCamera().GetForward();
-
-  float screen_width = (float)GetScreenWidth();
-  float screen_height = (float)GetScreenHeight();
- 
-  Matrix projection = MatrixPerspective(
-    camera.GetCamera().GetFOV() * DEG2RAD,
-    screen_width / screen_height, 
-    0.01, 
-    100.0
-  );
-  
-  Matrix view = MatrixLookAt(
-    cam_position, 
-    Vector3Add(cam_position, cam_forward), 
-    { 0.f, 1.f, 0.f }
-  );
-
-  Matrix view_projection = MatrixMultiply(view, projection);
+  if (arena_ == nullptr) {
+    return;
+  }
 
-  Matrix offset = MatrixIdentity();
+  Matrix offset = ComposeTransform(position, rotation, scale);
 
-  offset = MatrixMultiply(
-    offset, 
-    MatrixScale(scale.x, scale.y, scale.z)
-  );
-  offset = MatrixMultiply(
-    offset, 
-    QuaternionToMatrix(rotation)
-  );
-  offset = MatrixMultiply(
-    offset, 
-    MatrixTranslate(position.x, position.y, position.z)
-  );
-    
   glUseProgram(shader.id);
 
-  SetShaderValueMatrix(shader, view_projection_loc, view_projection);
+  // view and projection come from the CameraMatrices block
+  glUniformMatrix4fv(model_matrix_loc, 1, GL_FALSE, MatrixToFloatV(offset).v);
+  SetQuantizationUniforms(quantization_uniforms, quantization_);
 
-  for (int i = 0; i < meshes_.size(); ++i) {
-    for (int j = 0; j < meshes_[i].vao_.size(); ++j) {
+  arena_->Bind();
 
-      SetShaderValueMatrix(
-        shader, 
-        model_matrix_loc, 
-        offset
-      );
+  // colors come from the palette, so every primitive sharing an index
+  // type goes out in the same multi-draw
+  for (unsigned int index_type : { GL_UNSIGNED_SHORT, GL_UNSIGNED_INT }) {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> base_vertices;
 
-      SetShaderValue(
-        shader, 
-        base_color_loc, 
-        &meshes_[i].base_color_[j], 
-        SHADER_UNIFORM_VEC3
-      );
+    for (const CustomMesh& mesh : meshes_) {
+      for (int j = 0; j < mesh.ranges_.size(); ++j) {
+        if (mesh.index_type_[j] != index_type) {
+          continue;
+        }
 
-      glBindVertexArray(meshes_[i].vao_[j]);
-      glDrawElements(
+        const CustomLod& lod = mesh.lods_[j][0];
+        counts.push_back(lod.index_count_);
+        offsets.push_back((const void*)(uintptr_t)lod.index_offset_);
+        base_vertices.push_back(mesh.ranges_[j].first_vertex_);
+      }
+    }
+
+    if (!counts.empty()) {
+      glMultiDrawElementsBaseVertex(
         GL_TRIANGLES, 
-        meshes_[i].index_count_[j],
-        GL_UNSIGNED_INT, 
-        nullptr
+        counts.data(), 
+        index_type, 
+        offsets.data(), 
+        counts.size(), 
+        base_vertices.data()
       );
-      glBindVertexArray(0);
     }
   }
 
+  glBindVertexArray(0);
   glUseProgram(0);
 }
 
-const BoundingBox GetMeshBounds(const CustomMesh& mesh) {
-  Vector3 min = mesh.mins_[0];
-  Vector3 max = mesh.maxs_[0];
-
-  for (int i = 1; i < mesh.mins_.size(); ++i) {
-    min = Vector3Min(min, mesh.mins_[i]);
-    max = Vector3Max(min, mesh.maxs_[i]);
+void CustomModel::DrawInstanced(int instance_count, int lod) {
+  if (instance_count == 0) {
+    return;
   }
 
-  return { min, max };
-}
+  // no per-primitive state at all, only the draws themselves
+  for (int i = 0; i < meshes_.size(); ++i) {
+    for (int j = 0; j < meshes_[i].ranges_.size(); ++j) {
+      const std::vector<CustomLod>& lods = meshes_[i].lods_[j];
+      // primitives that simplified less stay on their coarsest level
+      const CustomLod& primitive_lod = lods[std::min(lod, (int)lods.size() - 1)];
 
-const BoundingBox CustomModel::GetBoundingBox() const {
-  BoundingBox bounds = { 0 };
+      glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES, 
+        primitive_lod.index_count_,
+        meshes_[i].index_type_[j], 
+        (void*)(uintptr_t)primitive_lod.index_offset_,
+        instance_count,
+        meshes_[i].ranges_[j].first_vertex_
+      );
+    }
+  }
+}
 
-  if (!meshes_.empty()) {
-    Vector3 temp = { 0 };
-    bounds = GetMeshBounds(meshes_[0]);
+const int CustomModel::GetLodCount() const {
+  return lod_errors_.size();
+}
 
-    for (int i = 1; i < meshes_.size(); ++i) {
-      BoundingBox temp_bounds = GetMeshBounds(meshes_[i]);
+const std::vector<float>& CustomModel::GetLodErrors() const {
+  return lod_errors_;
+}
 
-      bounds.min = Vector3Min(bounds.min, temp_bounds.min);
-      bounds.max = Vector3Max(bounds.max, temp_bounds.max);
+const int CustomModel::SelectLod(float pixels_per_unit) const {
+  int lod = 0;
+  for (int i = 1; i < lod_errors_.size(); ++i) {
+    if (lod_errors_[i] * pixels_per_unit > kLodMaxPixelError) {
+      break;
     }
+    lod = i;
   }
 
-  return bounds;
+  return lod;
 }
 
+const BoundingBox CustomModel::GetBoundingBox() const {
+  return bounds_;
+}
+
+const CustomGeometry& CustomModel::GetGeometry() const {
+  return geometry_;
+}
+
+const std::vector<CustomMesh>& CustomModel::GetMeshes() const {
+  return meshes_;
+}
+
+const VertexQuantization CustomModel::GetVertexQuantization() const {
+  return quantization_;
+}
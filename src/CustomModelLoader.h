@@ -2,50 +2,114 @@
 #define CUSTOM_MODEL_LOADER_H_
 
 #include <raylib.h>
-#include <tiny_gltf.h>
+#include <raymath.h>
 
 #include <vector>
 
-#include "FlyCamera.h"
+#include "GeometryArena.h"
+#include "MappedFile.h"
+#include "MaterialPalette.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+
+// Everything that can be done for a model before touching GL: the file
+// read, the glTF parse or cache mapping, and the bounds. Safe to build on
+// a worker thread, then hand to CustomModel::Upload on the GL thread.
+struct ModelData {
+  MappedFile cache_file_;
+  std::vector<unsigned char> baked_;
+  MeshCacheView view_;
+  BoundingBox bounds_;
+  bool valid_ = false;
+};
+
+bool LoadModelData(const char* filename, ModelData* data);
+
+// a lod is switched to once its error covers less than this many pixels
+constexpr float kLodMaxPixelError = 1.0f;
+
+struct CustomLod {
+  // in bytes into the arena's index buffer
+  uint32_t index_offset_;
+  int index_count_;
+};
 
 struct CustomMesh {
-  std::vector<unsigned int> vao_;
-  std::vector<unsigned int> vbo_;
-  std::vector<unsigned int> ebo_;
-  std::vector<Vector3> base_color_;
-  Matrix transform_;
-  std::vector<int> index_count_;
-  std::vector<Vector3> mins_;
-  std::vector<Vector3> maxs_;
+  std::vector<ArenaRange> ranges_;
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  std::vector<unsigned int> index_type_;
+  // per primitive, full detail first
+  std::vector<std::vector<CustomLod>> lods_;
+};
+
+// full detail triangles of the whole model in model space, kept on the cpu
+// for anything that merges models together after they are uploaded
+struct CustomGeometry {
+  std::vector<Vector3> positions_;
+  // palette index of every vertex
+  std::vector<uint32_t> materials_;
+  std::vector<uint32_t> indices_;
 };
 
 class CustomModel { 
 public:
   CustomModel() = default;
-  void LoadFromMemory(const char* filename);
+  void LoadFromMemory(
+    const char* filename, 
+    GeometryArena& arena, 
+    MaterialPalette& palette
+  );
+  // base colors go into the palette, the caller uploads it afterwards
+  void Upload(
+    const ModelData& data, 
+    GeometryArena& arena, 
+    MaterialPalette& palette
+  );
   void Unload();
+  // locations are looked up once by the caller, not on every draw
   void Draw(
-    FlyCamera& camera, 
     Shader shader,
     int model_matrix_loc,
-    int view_projection_loc,
-    int base_color_loc,
+    const QuantizationUniforms& quantization_uniforms,
     Vector3 position = { 0.0, 0.0, 0.0 }, 
     Quaternion rotation = QuaternionIdentity(),
     Vector3 scale = { 1.0, 1.0, 1.0 }
   );
+  // expects the instanced shader in use, the arena bound and its instance
+  // offset pointing at this model's transforms
+  void DrawInstanced(int instance_count, int lod = 0);
+
+  const int GetLodCount() const;
+  // worst error of each lod over all primitives, in model units
+  const std::vector<float>& GetLodErrors() const;
+  // coarsest lod whose error stays under kLodMaxPixelError, given how many
+  // pixels one world unit covers at the object's distance
+  const int SelectLod(float pixels_per_unit) const;
+
   const BoundingBox GetBoundingBox() const;
+  const CustomGeometry& GetGeometry() const;
+  const std::vector<CustomMesh>& GetMeshes() const;
+  // one box for the whole model, so a single uniform covers every draw
+  const VertexQuantization GetVertexQuantization() const;
 private:
   std::vector<CustomMesh> meshes_;
-private:
-  void ProcessNodes(const tinygltf::Node& node, const tinygltf::Model& model);
-  void ProcessMesh(
-    const tinygltf::Mesh& mesh, 
-    const tinygltf::Model& model,
-    const Matrix& transform
-  );
+  CustomGeometry geometry_;
+  // worst error of each lod over all primitives
+  std::vector<float> lod_errors_;
+  BoundingBox bounds_ = { 0 };
+  VertexQuantization quantization_ = { { 0 }, { 1.0, 1.0, 1.0 } };
+
+  GeometryArena* arena_ = nullptr;
 };
 
+// parses a .glb into the baked cache format, optimizing every primitive
+const std::vector<unsigned char> BakeModel(
+  const unsigned char* data, 
+  unsigned int data_size,
+  uint64_t source_hash,
+  MeshOptimizeStats* stats = nullptr
+);
+
 
 
 #endif
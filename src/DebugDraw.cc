@@ -0,0 +1,296 @@
+#include "DebugDraw.h"
+
+#include <glad.h>
+#include <raylib-physfs.h>
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "CameraUniforms.h"
+
+constexpr int kDebugPositionAttribute = 0;
+constexpr int kDebugColorAttribute = 1;
+
+static const Color GetColor(const btVector3& color) {
+  return Color {
+    (unsigned char)(Clamp(color.x(), 0.f, 1.f) * 255.f),
+    (unsigned char)(Clamp(color.y(), 0.f, 1.f) * 255.f),
+    (unsigned char)(Clamp(color.z(), 0.f, 1.f) * 255.f),
+    255
+  };
+}
+
+DebugDraw::DebugDraw() {
+  shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/debug.vert",
+    "assets/shaders/debug.frag"
+  );
+  BindCameraUniformBlock(shader_);
+
+  glGenVertexArrays(1, &vao_);
+  glGenBuffers(1, &vbo_);
+  capacity_ = 0;
+
+  glBindVertexArray(vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+
+  glVertexAttribPointer(
+    kDebugPositionAttribute,
+    3,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(DebugVertex),
+    (void*)offsetof(DebugVertex, position_)
+  );
+  glEnableVertexAttribArray(kDebugPositionAttribute);
+
+  glVertexAttribPointer(
+    kDebugColorAttribute,
+    4,
+    GL_UNSIGNED_BYTE,
+    GL_TRUE,
+    sizeof(DebugVertex),
+    (void*)offsetof(DebugVertex, color_)
+  );
+  glEnableVertexAttribArray(kDebugColorAttribute);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  debug_mode_ = btIDebugDraw::DBG_DrawWireframe;
+
+  line_count_ = 0;
+  triangle_count_ = 0;
+}
+
+DebugDraw::~DebugDraw() {
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteBuffers(1, &vbo_);
+  UnloadShader(shader_);
+}
+
+void DebugDraw::AddLine(Vector3 start, Vector3 end, Color color) {
+  lines_.push_back(DebugVertex { .position_ = start, .color_ = color });
+  lines_.push_back(DebugVertex { .position_ = end, .color_ = color });
+}
+
+void DebugDraw::AddBox(const BoundingBox& box, Color color) {
+  Vector3 p1 = box.min;
+  Vector3 p2 = box.max;
+
+  Vector3 p3 = { p2.x, p1.y, p2.z };
+  Vector3 p4 = { p1.x, p1.y, p2.z };
+  Vector3 p5 = { p2.x, p1.y, p1.z };
+
+  Vector3 p6 = { p1.x, p2.y, p2.z };
+  Vector3 p7 = { p1.x, p2.y, p1.z };
+  Vector3 p8 = { p2.x, p2.y, p1.z };
+
+  AddLine(p1, p5, color);
+  AddLine(p1, p4, color);
+  AddLine(p4, p3, color);
+  AddLine(p3, p5, color);
+
+  AddLine(p5, p8, color);
+  AddLine(p4, p6, color);
+  AddLine(p1, p7, color);
+  AddLine(p2, p3, color);
+
+  AddLine(p7, p8, color);
+  AddLine(p7, p6, color);
+  AddLine(p6, p2, color);
+  AddLine(p2, p8, color);
+}
+
+void DebugDraw::AddSphere(Vector3 center, float radius, Color color) {
+  profile_.clear();
+  for (int i = 0; i <= kDebugRings; ++i) {
+    float angle = -PI * 0.5f + PI * i / kDebugRings;
+    profile_.push_back({ radius * cosf(angle), radius * sinf(angle) });
+  }
+
+  AddRevolved(center, { 0.f, 1.f, 0.f }, profile_, color);
+}
+
+void DebugDraw::AddCapsule(
+  Vector3 start,
+  Vector3 end,
+  float radius,
+  Color color
+) {
+  Vector3 axis = Vector3Subtract(end, start);
+  float length = Vector3Length(axis);
+  axis = length > 0.f ? Vector3Scale(axis, 1.f / length) : Vector3 { 0.f, 1.f, 0.f };
+
+  // a hemisphere at each end, the cylinder is the gap between them
+  profile_.clear();
+  for (int i = 0; i <= kDebugRings / 2; ++i) {
+    float angle = -PI * 0.5f + PI * i / kDebugRings;
+    profile_.push_back({ radius * cosf(angle), radius * sinf(angle) });
+  }
+  for (int i = 0; i <= kDebugRings / 2; ++i) {
+    float angle = PI * i / kDebugRings;
+    profile_.push_back({ radius * cosf(angle), length + radius * sinf(angle) });
+  }
+
+  AddRevolved(start, axis, profile_, color);
+}
+
+void DebugDraw::AddRevolved(
+  Vector3 base,
+  Vector3 axis,
+  const std::vector<Vector2>& profile,
+  Color color
+) {
+  Vector3 helper = fabsf(axis.y) < 0.99f ?
+    Vector3 { 0.f, 1.f, 0.f } : Vector3 { 1.f, 0.f, 0.f };
+  Vector3 side = Vector3Normalize(Vector3CrossProduct(axis, helper));
+  Vector3 up = Vector3CrossProduct(axis, side);
+
+  ring_.clear();
+  for (const Vector2& point : profile) {
+    Vector3 center = Vector3Add(base, Vector3Scale(axis, point.y));
+    for (int slice = 0; slice < kDebugSlices; ++slice) {
+      float angle = 2.f * PI * slice / kDebugSlices;
+      Vector3 offset = Vector3Add(
+        Vector3Scale(side, cosf(angle) * point.x),
+        Vector3Scale(up, sinf(angle) * point.x)
+      );
+      ring_.push_back(Vector3Add(center, offset));
+    }
+  }
+
+  for (int i = 0; i + 1 < profile.size(); ++i) {
+    const Vector3* lower = &ring_[i * kDebugSlices];
+    const Vector3* upper = &ring_[(i + 1) * kDebugSlices];
+
+    for (int slice = 0; slice < kDebugSlices; ++slice) {
+      int next = (slice + 1) % kDebugSlices;
+
+      for (Vector3 position : {
+        lower[slice], upper[slice], upper[next],
+        lower[slice], upper[next], lower[next]
+      }) {
+        triangles_.push_back(DebugVertex {
+          .position_ = position,
+          .color_ = color
+        });
+      }
+    }
+  }
+}
+
+void DebugDraw::Flush() {
+  line_count_ = lines_.size() / 2;
+  triangle_count_ = triangles_.size() / 3;
+
+  if (lines_.empty() && triangles_.empty()) {
+    return;
+  }
+
+  frame_vertices_.assign(lines_.cbegin(), lines_.cend());
+  frame_vertices_.insert(
+    frame_vertices_.end(),
+    triangles_.cbegin(),
+    triangles_.cend()
+  );
+
+  int vertex_count = frame_vertices_.size();
+
+  // orphaned every frame like the instance buffer, grown as needed
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  if (vertex_count > capacity_) {
+    capacity_ = vertex_count;
+  }
+  glBufferData(
+    GL_ARRAY_BUFFER,
+    sizeof(DebugVertex) * capacity_,
+    nullptr,
+    GL_STREAM_DRAW
+  );
+  glBufferSubData(
+    GL_ARRAY_BUFFER,
+    0,
+    sizeof(DebugVertex) * vertex_count,
+    frame_vertices_.data()
+  );
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glUseProgram(shader_.id);
+  glBindVertexArray(vao_);
+
+  if (!lines_.empty()) {
+    glDrawArrays(GL_LINES, 0, lines_.size());
+  }
+
+  if (!triangles_.empty()) {
+    glDrawArrays(GL_TRIANGLES, lines_.size(), triangles_.size());
+  }
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+
+  lines_.clear();
+  triangles_.clear();
+}
+
+const int DebugDraw::GetLineCount() const {
+  return line_count_;
+}
+
+const int DebugDraw::GetTriangleCount() const {
+  return triangle_count_;
+}
+
+void DebugDraw::drawLine(
+  const btVector3& from,
+  const btVector3& to,
+  const btVector3& color
+) {
+  AddLine(
+    Vector3 { from.x(), from.y(), from.z() },
+    Vector3 { to.x(), to.y(), to.z() },
+    GetColor(color)
+  );
+}
+
+void DebugDraw::drawContactPoint(
+  const btVector3& point,
+  const btVector3& normal,
+  btScalar distance,
+  int life_time,
+  const btVector3& color
+) {
+  drawLine(point, point + normal * distance, color);
+}
+
+void DebugDraw::reportErrorWarning(const char* warning) {
+  std::cout << "WARNING: " << warning << std::endl;
+}
+
+void DebugDraw::draw3dText(const btVector3& location, const char* text) {
+  // nothing to draw text with in 3d
+}
+
+void DebugDraw::setDebugMode(int debug_mode) {
+  debug_mode_ = debug_mode;
+}
+
+int DebugDraw::getDebugMode() const {
+  return debug_mode_;
+}
+
+void DrawDebugDrawStats(const DebugDraw& debug_draw) {
+  DrawText(
+    TextFormat(
+      "DEBUG DRAW: %d LINES  %d TRIANGLES",
+      debug_draw.GetLineCount(),
+      debug_draw.GetTriangleCount()
+    ),
+    20,
+    220,
+    24,
+    YELLOW
+  );
+}
@@ -0,0 +1,93 @@
+#ifndef DEBUG_DRAW_H_
+#define DEBUG_DRAW_H_
+
+#include <raylib.h>
+#include <raymath.h>
+#include <btBulletDynamicsCommon.h>
+
+#include <vector>
+
+// segments around spheres and capsules, gizmos are small on screen
+constexpr int kDebugSlices = 8;
+constexpr int kDebugRings = 8;
+
+struct DebugVertex {
+  Vector3 position_;
+  Color color_;
+};
+
+// Collects editor overlays for the whole frame instead of drawing each one
+// in place. Lines go into one vertex stream and solid spheres and capsules
+// into another, so a frame of overlays is two draws however many objects
+// are outlined. Doubles as Bullet's debug drawer.
+class DebugDraw : public btIDebugDraw {
+public:
+  DebugDraw();
+  ~DebugDraw();
+
+  DebugDraw(const DebugDraw&) = delete;
+  DebugDraw& operator=(const DebugDraw&) = delete;
+
+  void AddLine(Vector3 start, Vector3 end, Color color);
+  // axis aligned, as a wireframe
+  void AddBox(const BoundingBox& box, Color color);
+  void AddSphere(Vector3 center, float radius, Color color);
+  void AddCapsule(Vector3 start, Vector3 end, float radius, Color color);
+
+  // draws everything collected since the last flush, then empties it.
+  // view and projection come from the CameraMatrices block
+  void Flush();
+
+  const int GetLineCount() const;
+  const int GetTriangleCount() const;
+
+  void drawLine(
+    const btVector3& from,
+    const btVector3& to,
+    const btVector3& color
+  ) override;
+  void drawContactPoint(
+    const btVector3& point,
+    const btVector3& normal,
+    btScalar distance,
+    int life_time,
+    const btVector3& color
+  ) override;
+  void reportErrorWarning(const char* warning) override;
+  void draw3dText(const btVector3& location, const char* text) override;
+  void setDebugMode(int debug_mode) override;
+  int getDebugMode() const override;
+private:
+  // sweeps (radius, height) pairs around the axis through base, a profile
+  // starting and ending at radius 0 closes itself
+  void AddRevolved(
+    Vector3 base,
+    Vector3 axis,
+    const std::vector<Vector2>& profile,
+    Color color
+  );
+private:
+  Shader shader_;
+
+  unsigned int vao_;
+  unsigned int vbo_;
+  int capacity_;
+
+  std::vector<DebugVertex> lines_;
+  std::vector<DebugVertex> triangles_;
+  // both streams back to back, uploaded in one go
+  std::vector<DebugVertex> frame_vertices_;
+
+  // reused between calls so building a shape doesn't allocate
+  std::vector<Vector2> profile_;
+  std::vector<Vector3> ring_;
+
+  int debug_mode_;
+
+  int line_count_;
+  int triangle_count_;
+};
+
+void DrawDebugDrawStats(const DebugDraw& debug_draw);
+
+#endif
@@ -0,0 +1,67 @@
+#include "FixedTimestep.h"
+
+#include <cmath>
+
+FixedTimestep::FixedTimestep(float tick_rate, int max_ticks) {
+  timestep_ = 1.f / tick_rate;
+  max_ticks_ = max_ticks;
+
+  accumulator_ = 0.f;
+  dropped_ticks_ = 0;
+}
+
+void FixedTimestep::SetTickRate(float tick_rate) {
+  timestep_ = 1.f / tick_rate;
+  accumulator_ = fminf(accumulator_, timestep_);
+}
+
+void FixedTimestep::SetMaxTicks(int max_ticks) {
+  max_ticks_ = max_ticks;
+}
+
+const int FixedTimestep::Advance(float frame_time) {
+  accumulator_ += frame_time;
+
+  int tick_count = (int)(accumulator_ / timestep_);
+  if (tick_count > max_ticks_) {
+    dropped_ticks_ += tick_count - max_ticks_;
+    tick_count = max_ticks_;
+    // keeps the fraction so interpolation doesn't jump
+    accumulator_ = fmodf(accumulator_, timestep_) + timestep_ * tick_count;
+  }
+
+  accumulator_ -= timestep_ * tick_count;
+  return tick_count;
+}
+
+void FixedTimestep::Reset() {
+  accumulator_ = 0.f;
+  dropped_ticks_ = 0;
+}
+
+const float FixedTimestep::GetTimestep() const {
+  return timestep_;
+}
+
+const float FixedTimestep::GetAlpha() const {
+  return accumulator_ / timestep_;
+}
+
+const int FixedTimestep::GetDroppedTicks() const {
+  return dropped_ticks_;
+}
+
+void DrawTimestepStats(const FixedTimestep& timestep) {
+  DrawText(
+    TextFormat(
+      "TICKS: %.0f HZ  %d FPS  %d DROPPED",
+      1.f / timestep.GetTimestep(),
+      GetFPS(),
+      timestep.GetDroppedTicks()
+    ),
+    20,
+    250,
+    24,
+    YELLOW
+  );
+}
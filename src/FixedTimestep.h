@@ -0,0 +1,45 @@
+#ifndef FIXED_TIMESTEP_H_
+#define FIXED_TIMESTEP_H_
+
+#include <raylib.h>
+
+// movement thresholds and blend factors in PlayerMovement were tuned
+// per tick at the old 120 fps cap, they are rescaled for any other rate
+constexpr float kDefaultTickRate = 120.f;
+// at most this many ticks per frame, anything slower runs in slow motion
+// instead of falling further behind every frame
+constexpr int kDefaultMaxTicks = 6;
+
+// Turns variable frame times into a whole number of fixed ticks. The time
+// left over is kept for the next frame, and how far it is into the next
+// tick is what rendering interpolates by.
+class FixedTimestep {
+public:
+  FixedTimestep(
+    float tick_rate = kDefaultTickRate, 
+    int max_ticks = kDefaultMaxTicks
+  );
+
+  void SetTickRate(float tick_rate);
+  void SetMaxTicks(int max_ticks);
+
+  // adds the frame's time and returns how many ticks to run for it
+  const int Advance(float frame_time);
+  void Reset();
+
+  const float GetTimestep() const;
+  // 0 right on the last tick, approaching 1 just before the next one
+  const float GetAlpha() const;
+  // ticks thrown away because a frame went over the budget
+  const int GetDroppedTicks() const;
+private:
+  float timestep_;
+  int max_ticks_;
+
+  float accumulator_;
+  int dropped_ticks_;
+};
+
+void DrawTimestepStats(const FixedTimestep& timestep);
+
+#endif
@@ -12,8 +12,10 @@ Game::Game(LevelEditor& editor) {
 
   Vector3 flag_bound_size = Vector3Subtract(flag_bounds.max, flag_bounds.min);
   
-  flag_shape_ = physics_.CreateBoxShape(flag_bound_size);
+  flag_shape_ = physics_.GetAssetBoxShape(kFlagModelIndex, flag_bound_size);
   camera_ = FlyCamera({ 0.0, 2.0, -5.0 }, 0.1, 5.0);
+  previous_eye_ = Vector3Zero();
+  current_eye_ = Vector3Zero();
 
   Wave wave = LoadWaveFromPhysFS("assets/sounds/coin.wav");
   coin_pickup_sfx_ = LoadSoundFromWave(wave);
@@ -24,6 +26,9 @@ Game::Game(LevelEditor& editor) {
   previous_score_ = 0;
   current_score_ = 0;
 
+  flag_transform_.Resize(1);
+  transforms_dirty_ = true;
+
   flag_ = Flag {
     .flag_position_ = { 1.0, 0.0, 0.0 },
     .flag_rotation_ = Quaternion { 0.0, 0.0, 0.0, 1.0 },
@@ -32,34 +37,52 @@ Game::Game(LevelEditor& editor) {
 }
 
 void Game::Setup(LevelEditor& editor) {
+  // a freshly loaded level may have the same object count as the last one
+  transforms_dirty_ = true;
+
   player_movement_.ResetStamina();
   DisableCursor();
 
+  std::vector<StaticObject> static_objects;
+
   for (const LevelMesh& mesh : meshes_) {
     ModelComponent& model = editor.GetAsset(mesh.index_).model_;
-    BoundingBox bounds = model.GetBoundingBox();
 
-    Vector3 size = Vector3Subtract(bounds.max, bounds.min);
-    mesh_colliders_.emplace_back(physics_.CreateBoxShape(size));
+    // baked once per asset, later setups and instances share it
+    btCollisionShape* shape = physics_.GetAssetShape(
+      mesh.index_, 
+      editor.GetAssetName(mesh.index_),
+      model.GetBoundingBox(),
+      model.GetCustomGeometry()
+    );
 
-    std::unique_ptr<btCollisionShape>& box = mesh_colliders_.back();
+    if (kMergeStaticCollision) {
+      static_objects.push_back(StaticObject {
+        .shape_ = shape,
+        .position_ = mesh.pos_,
+        .rotation_ = mesh.rotation_
+      });
+      continue;
+    }
         
     mesh_bodies_.emplace_back(physics_.CreateRigidBody(
       mesh.pos_,
-      box,
+      shape,
       mesh.rotation_,
       0.f
     ));
   }
 
+  if (kMergeStaticCollision) {
+    physics_.BuildStaticWorld(static_objects);
+  }
+
   for (LevelCoin& coin : coins_) {
     ModelComponent& model = editor.GetAsset(coin.index_).model_;
     BoundingBox bounds = model.GetBoundingBox();
 
     Vector3 size = Vector3Subtract(bounds.max, bounds.min);
-    coin_colliders_.emplace_back(physics_.CreateBoxShape(size));
-
-    std::unique_ptr<btCollisionShape>& box = coin_colliders_.back();
+    btCollisionShape* box = physics_.GetAssetBoxShape(coin.index_, size);
         
     coin_bodies_.emplace_back(physics_.CreateRigidBody(
       coin.pos_,
@@ -107,12 +130,20 @@ void Game::Setup(LevelEditor& editor) {
 
   camera_.GetCamera().SetPitch(0.f);
   camera_.GetCamera().SetYaw(editor.GetPlayerYaw());
+
+  // the frame that loaded the level shouldn't be simulated
+  timestep_.Reset();
+  current_eye_ = player_movement_.GetEyePosition(player_);
+  previous_eye_ = current_eye_;
+  camera_.GetCamera().SetPosition(current_eye_);
+
   loaded_ = true;
 }
 
 void Game::Unload() {
-  mesh_colliders_.clear();
-  coin_colliders_.clear();
+  // bodies go back to the physics world's pool and shapes stay cached, so
+  // the next Setup allocates nothing for assets it has seen before
+  physics_.ClearStaticWorld();
 
   for (RigidBody& body : mesh_bodies_) {
     physics_.ReleaseBody(&body);
@@ -149,30 +180,19 @@ void Game::Update(const LevelEditor& editor) {
   if (!loaded_) {
     return;
   }
-  physics_.Update(1.0 / 60.0);
-  camera_.LookAround();
-  player_movement_.Update(player_, camera_);
-
-  if (camera_.GetCamera().GetPosition().y <= -10.f) {
-    player_movement_.ResetStamina();
-
-    btTransform transform;
-    transform.setIdentity();
-
-    Vector3 player_pos = editor.GetPlayerPosition();
-    transform.setOrigin(btVector3(player_pos.x, player_pos.y, player_pos.z));
 
-    player_.ghost_object_->setWorldTransform(transform);
-
-    camera_.GetCamera().SetPitch(0.f);
-    camera_.GetCamera().SetYaw(editor.GetPlayerYaw());
+  // looking around follows the mouse every frame, only movement is ticked
+  camera_.LookAround();
+  player_movement_.PollInput();
 
-    previous_score_ = 0;
+  int tick_count = timestep_.Advance(GetFrameTime());
+  for (int i = 0; i < tick_count; ++i) {
+    Tick(editor);
+  }
 
-    for (LevelCoin& coin : coins_) {
-      coin.collected_ = false;
-    }
-  }   
+  camera_.GetCamera().SetPosition(
+    Vector3Lerp(previous_eye_, current_eye_, timestep_.GetAlpha())
+  );
 
   current_score_ = std::count_if(
     coins_.cbegin(), 
@@ -188,11 +208,56 @@ void Game::Update(const LevelEditor& editor) {
   }
 }
 
+void Game::Tick(const LevelEditor& editor) {
+  float timestep = timestep_.GetTimestep();
+
+  player_movement_.Update(player_, camera_, timestep);
+  physics_.Update(timestep * kPhysicsTimeScale);
+
+  previous_eye_ = current_eye_;
+  current_eye_ = player_movement_.GetEyePosition(player_);
+
+  if (current_eye_.y <= -10.f) {
+    Respawn(editor);
+  }
+}
+
+void Game::Respawn(const LevelEditor& editor) {
+  player_movement_.ResetStamina();
+
+  btTransform transform;
+  transform.setIdentity();
+
+  Vector3 player_pos = editor.GetPlayerPosition();
+  transform.setOrigin(btVector3(player_pos.x, player_pos.y, player_pos.z));
+
+  player_.ghost_object_->setWorldTransform(transform);
+
+  camera_.GetCamera().SetPitch(0.f);
+  camera_.GetCamera().SetYaw(editor.GetPlayerYaw());
+
+  // a teleport, nothing to interpolate across
+  current_eye_ = player_movement_.GetEyePosition(player_);
+  previous_eye_ = current_eye_;
+
+  previous_score_ = 0;
+
+  for (LevelCoin& coin : coins_) {
+    coin.collected_ = false;
+  }
+}
+
 void Game::DrawUI() {
   DrawStamina(player_movement_);
   DrawText(TextFormat("SCORE: %d", current_score_), 20, 90, 32, WHITE);
 }
 
+void Game::DrawPhysics(btIDebugDraw& debug_draw) {
+  if (loaded_) {
+    physics_.DrawDebug(debug_draw);
+  }
+}
+
 Camera Game::GetCamera() {
   return camera_.GetCamera().GetCamera();
 }
@@ -200,10 +265,7 @@ Camera Game::GetCamera() {
 Game::~Game() {
   UnloadSound(coin_pickup_sfx_);
 
-  mesh_colliders_.clear();
-  coin_colliders_.clear();
-
-  flag_shape_.reset();
+  physics_.ClearStaticWorld();
 
   for (RigidBody& body : mesh_bodies_) {
     physics_.ReleaseBody(&body);
@@ -237,6 +299,43 @@ std::vector<LevelCoin>& Game::GetCoins() {
   return coins_;
 }
 
+void Game::UpdateTransforms(bool is_editing) {
+  if (!is_editing && !transforms_dirty_) {
+    return;
+  }
+
+  mesh_transforms_.Resize(meshes_.size());
+  for (int i = 0; i < meshes_.size(); ++i) {
+    mesh_transforms_.Set(i, meshes_[i].pos_, meshes_[i].rotation_);
+  }
+
+  coin_transforms_.Resize(coins_.size());
+  for (int i = 0; i < coins_.size(); ++i) {
+    coin_transforms_.Set(i, coins_[i].pos_, coins_[i].rotation_);
+  }
+
+  flag_transform_.Resize(1);
+  flag_transform_.Set(0, flag_.flag_position_, flag_.flag_rotation_);
+
+  mesh_transforms_.Update();
+  coin_transforms_.Update();
+  flag_transform_.Update();
+
+  transforms_dirty_ = false;
+}
+
+const TransformCache& Game::GetMeshTransforms() const {
+  return mesh_transforms_;
+}
+
+const TransformCache& Game::GetCoinTransforms() const {
+  return coin_transforms_;
+}
+
+const float16& Game::GetFlagTransform() const {
+  return flag_transform_.GetMatrix(0);
+}
+
 std::string Game::NextLevel() {
   assert(!level_filenames_.empty());
   std::string filename = level_filenames_.back();
@@ -265,3 +364,7 @@ FlyCamera& Game::GetFlyCamera() {
   return camera_;
 }
 
+FixedTimestep& Game::GetTimestep() {
+  return timestep_;
+}
+
@@ -4,7 +4,15 @@
 #include "PhysicsWorld.h"
 #include "LevelEditor.h"
 #include "PlayerMovement.h"
+#include "FixedTimestep.h"
 #include "FlyCamera.h"
+#include "TransformCache.h"
+
+// tuned with a 1/60 s bullet step every frame at the old 120 fps cap, so
+// the world has always run at twice real time. gravity, fall speed and
+// jump arcs all depend on it, each tick steps physics this many times
+// its own length
+constexpr float kPhysicsTimeScale = 2.f;
 
 class Game {
 public:
@@ -18,20 +26,38 @@ public:
   void Setup(LevelEditor& editor);
   void Unload();
 
+  // runs as many fixed ticks as the frame's time covers, then places the
+  // camera between the last two ticks' eye positions
   void Update(const LevelEditor& editor);
 
+  FixedTimestep& GetTimestep();
+
   void DrawUI();
+  void DrawPhysics(btIDebugDraw& debug_draw);
 
   Flag& GetFlag();
   std::vector<LevelMesh>& GetMeshes();
   std::vector<LevelCoin>& GetCoins();
 
+  // while editing every object is compared against its cached transform
+  // and only the ones that moved are recomputed, a set up level is static
+  // and skips the work entirely
+  void UpdateTransforms(bool is_editing);
+
+  const TransformCache& GetMeshTransforms() const;
+  const TransformCache& GetCoinTransforms() const;
+  const float16& GetFlagTransform() const;
+
   std::string NextLevel();
 
   const int GetScore() const;
   const bool IsGameOver() const;
 
   ~Game();
+private:
+  void Tick(const LevelEditor& editor);
+  // puts the player back at the level's start
+  void Respawn(const LevelEditor& editor);
 private:
   bool loaded_ = false;
 
@@ -44,22 +70,28 @@ private:
   PhysicsWorld physics_;
 
   std::vector<RigidBody> mesh_bodies_;
-  std::vector<std::unique_ptr<btCollisionShape>> mesh_colliders_;
-
   std::vector<RigidBody> coin_bodies_;
-  std::vector<std::unique_ptr<btCollisionShape>> coin_colliders_;
-
   RigidBody flag_body_;
-  std::unique_ptr<btCollisionShape> flag_shape_;
+  // owned by the physics world's shape cache
+  btCollisionShape* flag_shape_;
 
   CharacterController player_;
   PlayerMovement player_movement_;
 
+  FixedTimestep timestep_;
+  Vector3 previous_eye_;
+  Vector3 current_eye_;
+
   std::vector<LevelMesh> meshes_;
   std::vector<LevelCoin> coins_;
 
   Flag flag_; 
 
+  TransformCache mesh_transforms_;
+  TransformCache coin_transforms_;
+  TransformCache flag_transform_;
+  bool transforms_dirty_;
+
   int current_score_;
   int previous_score_;
 };
@@ -0,0 +1,543 @@
+#include "GeometryArena.h"
+
+#include <glad.h>
+
+#include <algorithm>
+#include <cmath>
+
+// the quantized layout interleaves the material into the vertex, so only
+// the float layout has a second stream
+constexpr uint32_t kVertexStride = 
+  kQuantizeVertices ? kQuantizedVertexSize : sizeof(float) * 3;
+constexpr uint32_t kMaterialStride = sizeof(uint32_t);
+
+// locations 1 to 4 are taken by the instance matrix
+constexpr int kMaterialAttribute = 5;
+constexpr int kObjectIndexAttribute = 6;
+
+constexpr uint32_t kInitialVertexCapacity = 1 << 17;
+constexpr uint32_t kInitialIndexCapacity = 1 << 19;
+
+RangeAllocator::RangeAllocator(uint32_t capacity) {
+  capacity_ = 0;
+  Grow(capacity);
+}
+
+bool RangeAllocator::Allocate(uint32_t size, uint32_t* offset) {
+  for (auto it = free_.begin(); it != free_.end(); ++it) {
+    if (it->second < size) {
+      continue;
+    }
+
+    *offset = it->first;
+
+    uint32_t remaining = it->second - size;
+    free_.erase(it);
+
+    if (remaining > 0) {
+      free_[*offset + size] = remaining;
+    }
+    return true;
+  }
+  return false;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  auto it = free_.emplace(offset, size).first;
+
+  auto next = std::next(it);
+  if (next != free_.end() && it->first + it->second == next->first) {
+    it->second += next->second;
+    free_.erase(next);
+  }
+
+  if (it != free_.begin()) {
+    auto previous = std::prev(it);
+    if (previous->first + previous->second == it->first) {
+      previous->second += it->second;
+      free_.erase(it);
+    }
+  }
+}
+
+void RangeAllocator::Grow(uint32_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+
+  uint32_t old_capacity = capacity_;
+  capacity_ = capacity;
+  Free(old_capacity, capacity - old_capacity);
+}
+
+const uint32_t RangeAllocator::GetCapacity() const {
+  return capacity_;
+}
+
+const VertexQuantization GetVertexQuantization(const BoundingBox& bounds) {
+  if (!kQuantizeVertices) {
+    return VertexQuantization {
+      .offset_ = { 0.f, 0.f, 0.f },
+      .scale_ = { 1.f, 1.f, 1.f }
+    };
+  }
+
+  return VertexQuantization {
+    .offset_ = bounds.min,
+    .scale_ = Vector3Subtract(bounds.max, bounds.min)
+  };
+}
+
+const Matrix GetDequantizeMatrix(const VertexQuantization& quantization) {
+  return MatrixMultiply(
+    MatrixScale(
+      quantization.scale_.x, 
+      quantization.scale_.y, 
+      quantization.scale_.z
+    ),
+    MatrixTranslate(
+      quantization.offset_.x, 
+      quantization.offset_.y, 
+      quantization.offset_.z
+    )
+  );
+}
+
+const QuantizationUniforms GetQuantizationUniforms(unsigned int program) {
+  return QuantizationUniforms {
+    .offset_loc_ = glGetUniformLocation(program, "position_offset"),
+    .scale_loc_ = glGetUniformLocation(program, "position_scale")
+  };
+}
+
+void SetQuantizationUniforms(
+  const QuantizationUniforms& uniforms,
+  const VertexQuantization& quantization
+) {
+  const Vector3& offset = quantization.offset_;
+  const Vector3& scale = quantization.scale_;
+
+  glUniform3f(uniforms.offset_loc_, offset.x, offset.y, offset.z);
+  glUniform3f(uniforms.scale_loc_, scale.x, scale.y, scale.z);
+}
+
+static const uint16_t QuantizeComponent(float value, float offset, float scale) {
+  // flat along this axis, every vertex sits on the offset
+  if (scale <= 0.f) {
+    return 0;
+  }
+
+  float t = std::clamp((value - offset) / scale, 0.f, 1.f);
+  return (uint16_t)lroundf(t * 65535.f);
+}
+
+GeometryArena::GeometryArena() {
+  created_ = false;
+  vao_ = 0;
+  indirect_vao_ = 0;
+  vbo_ = 0;
+  material_vbo_ = 0;
+  ebo_ = 0;
+  instance_vbo_ = 0;
+  object_index_vbo_ = 0;
+  instance_capacity_ = 0;
+  vertex_count_ = 0;
+}
+
+GeometryArena::~GeometryArena() {
+  if (created_) {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteVertexArrays(1, &indirect_vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &material_vbo_);
+    glDeleteBuffers(1, &ebo_);
+    glDeleteBuffers(1, &instance_vbo_);
+  }
+}
+
+void GeometryArena::Create() {
+  // deferred until the first upload so the arena can be a member of
+  // objects that are built before it is safe to touch GL
+  created_ = true;
+
+  vertices_.Grow(kInitialVertexCapacity);
+  indices_.Grow(kInitialIndexCapacity);
+
+  glGenVertexArrays(1, &vao_);
+  glGenVertexArrays(1, &indirect_vao_);
+
+  glGenBuffers(1, &vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  glBufferData(
+    GL_ARRAY_BUFFER, 
+    kVertexStride * vertices_.GetCapacity(), 
+    nullptr, 
+    GL_STATIC_DRAW
+  );
+
+  if (!kQuantizeVertices) {
+    glGenBuffers(1, &material_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, material_vbo_);
+    glBufferData(
+      GL_ARRAY_BUFFER, 
+      kMaterialStride * vertices_.GetCapacity(), 
+      nullptr, 
+      GL_STATIC_DRAW
+    );
+  }
+
+  glGenBuffers(1, &ebo_);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+  glBufferData(
+    GL_COPY_WRITE_BUFFER, 
+    indices_.GetCapacity(), 
+    nullptr, 
+    GL_STATIC_DRAW
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glGenBuffers(1, &instance_vbo_);
+
+  SetVertexLayout();
+}
+
+void GeometryArena::SetVertexStreams() {
+  // expects the vao being set up to be bound
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  if (kQuantizeVertices) {
+    // normalized, so the shaders see positions in [0, 1]
+    glVertexAttribPointer(
+      0, 
+      3, 
+      GL_UNSIGNED_SHORT, 
+      GL_TRUE, 
+      kVertexStride, 
+      0
+    );
+    glVertexAttribIPointer(
+      kMaterialAttribute, 
+      1, 
+      GL_UNSIGNED_SHORT, 
+      kVertexStride, 
+      (void*)(sizeof(uint16_t) * 3)
+    );
+  } else {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, kVertexStride, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, material_vbo_);
+    glVertexAttribIPointer(
+      kMaterialAttribute, 
+      1, 
+      GL_UNSIGNED_INT, 
+      kMaterialStride, 
+      0
+    );
+  }
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(kMaterialAttribute);
+}
+
+void GeometryArena::SetVertexLayout() {
+  glBindVertexArray(vao_);
+  SetVertexStreams();
+
+  // mat4 instance attribute takes up locations 1 to 4, one column each
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+  for (int column = 0; column < 4; ++column) {
+    glVertexAttribPointer(
+      1 + column, 
+      4, 
+      GL_FLOAT, 
+      GL_FALSE, 
+      sizeof(float16),
+      (void*)(sizeof(float) * 4 * column)
+    );
+    glEnableVertexAttribArray(1 + column);
+    glVertexAttribDivisor(1 + column, 1);
+  }
+
+  // the indirect path's copy, instances are only an object index there
+  glBindVertexArray(indirect_vao_);
+  SetVertexStreams();
+
+  // not owned by the arena, but has to survive the buffers being regrown
+  if (object_index_vbo_ != 0) {
+    glBindBuffer(GL_ARRAY_BUFFER, object_index_vbo_);
+    glVertexAttribIPointer(
+      kObjectIndexAttribute, 
+      1, 
+      GL_UNSIGNED_INT, 
+      sizeof(uint32_t), 
+      0
+    );
+    glEnableVertexAttribArray(kObjectIndexAttribute);
+    glVertexAttribDivisor(kObjectIndexAttribute, 1);
+  } else {
+    glDisableVertexAttribArray(kObjectIndexAttribute);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static unsigned int GrowBuffer(
+  unsigned int buffer, 
+  uint32_t old_size, 
+  uint32_t new_size
+) {
+  unsigned int grown = 0;
+  glGenBuffers(1, &grown);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glDeleteBuffers(1, &buffer);
+  return grown;
+}
+
+void GeometryArena::GrowVertices(uint32_t vertex_count) {
+  uint32_t old_capacity = vertices_.GetCapacity();
+  uint32_t capacity = old_capacity;
+  while (capacity < old_capacity + vertex_count) {
+    capacity *= 2;
+  }
+
+  vbo_ = GrowBuffer(
+    vbo_, 
+    kVertexStride * old_capacity, 
+    kVertexStride * capacity
+  );
+  if (!kQuantizeVertices) {
+    material_vbo_ = GrowBuffer(
+      material_vbo_, 
+      kMaterialStride * old_capacity, 
+      kMaterialStride * capacity
+    );
+  }
+  vertices_.Grow(capacity);
+
+  SetVertexLayout();
+}
+
+void GeometryArena::GrowIndices(uint32_t index_size) {
+  uint32_t old_capacity = indices_.GetCapacity();
+  uint32_t capacity = old_capacity;
+  while (capacity < old_capacity + index_size) {
+    capacity *= 2;
+  }
+
+  ebo_ = GrowBuffer(ebo_, old_capacity, capacity);
+  indices_.Grow(capacity);
+
+  SetVertexLayout();
+}
+
+const ArenaRange GeometryArena::Allocate(
+  const unsigned char* vertices,
+  uint32_t vertex_count,
+  const unsigned char* indices,
+  uint32_t index_size,
+  uint32_t material,
+  const VertexQuantization& quantization
+) {
+  material_staging_.assign(vertex_count, material);
+  return Allocate(
+    vertices, 
+    vertex_count, 
+    indices, 
+    index_size, 
+    material_staging_.data(),
+    quantization
+  );
+}
+
+const ArenaRange GeometryArena::Allocate(
+  const unsigned char* vertices,
+  uint32_t vertex_count,
+  const unsigned char* indices,
+  uint32_t index_size,
+  const uint32_t* materials,
+  const VertexQuantization& quantization
+) {
+  if (!created_) {
+    Create();
+  }
+
+  ArenaRange range {
+    .first_vertex_ = 0,
+    .vertex_count_ = vertex_count,
+    .index_offset_ = 0,
+    // keeps every range 4 byte aligned whatever the index type is
+    .index_size_ = (index_size + 3) & ~3u
+  };
+
+  if (!vertices_.Allocate(range.vertex_count_, &range.first_vertex_)) {
+    GrowVertices(range.vertex_count_);
+    vertices_.Allocate(range.vertex_count_, &range.first_vertex_);
+  }
+
+  if (!indices_.Allocate(range.index_size_, &range.index_offset_)) {
+    GrowIndices(range.index_size_);
+    indices_.Allocate(range.index_size_, &range.index_offset_);
+  }
+
+  if (kQuantizeVertices) {
+    vertex_staging_.resize(vertex_count * 4);
+
+    const float* positions = (const float*)vertices;
+    const Vector3& offset = quantization.offset_;
+    const Vector3& scale = quantization.scale_;
+
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      const float* position = positions + i * 3;
+      uint16_t* packed = &vertex_staging_[i * 4];
+
+      packed[0] = QuantizeComponent(position[0], offset.x, scale.x);
+      packed[1] = QuantizeComponent(position[1], offset.y, scale.y);
+      packed[2] = QuantizeComponent(position[2], offset.z, scale.z);
+      // the palette never holds more than kMaxMaterials colors
+      packed[3] = (uint16_t)materials[i];
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER, 
+      kVertexStride * range.first_vertex_, 
+      kVertexStride * vertex_count, 
+      vertex_staging_.data()
+    );
+  } else {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER, 
+      kVertexStride * range.first_vertex_, 
+      kVertexStride * vertex_count, 
+      vertices
+    );
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, material_vbo_);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER, 
+      kMaterialStride * range.first_vertex_, 
+      kMaterialStride * vertex_count, 
+      materials
+    );
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER, 
+    range.index_offset_, 
+    index_size, 
+    indices
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  vertex_count_ += vertex_count;
+  return range;
+}
+
+void GeometryArena::Free(const ArenaRange& range) {
+  vertices_.Free(range.first_vertex_, range.vertex_count_);
+  indices_.Free(range.index_offset_, range.index_size_);
+  vertex_count_ -= range.vertex_count_;
+}
+
+const uint32_t GeometryArena::GetVertexCount() const {
+  return vertex_count_;
+}
+
+void GeometryArena::Bind() {
+  glBindVertexArray(vao_);
+}
+
+const unsigned int GeometryArena::GetVertexArray() const {
+  return vao_;
+}
+
+const unsigned int GeometryArena::GetIndirectVertexArray() const {
+  return indirect_vao_;
+}
+
+void GeometryArena::UploadInstances(const std::vector<float16>& transforms) {
+  if (!created_) {
+    Create();
+  }
+
+  int instance_count = transforms.size();
+
+  // orphan the old storage so the driver doesn't stall on last frame's draw
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+  if (instance_count > instance_capacity_) {
+    instance_capacity_ = instance_count;
+  }
+  glBufferData(
+    GL_ARRAY_BUFFER, 
+    sizeof(float16) * instance_capacity_, 
+    nullptr, 
+    GL_STREAM_DRAW
+  );
+  if (instance_count > 0) {
+    glBufferSubData(
+      GL_ARRAY_BUFFER, 
+      0, 
+      sizeof(float16) * instance_count, 
+      transforms.data()
+    );
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::SetInstanceOffset(int first_instance) {
+  // no base instance before GL 4.2, so move the attribute pointers instead.
+  // expects the arena's vao to be bound
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+  for (int column = 0; column < 4; ++column) {
+    glVertexAttribPointer(
+      1 + column, 
+      4, 
+      GL_FLOAT, 
+      GL_FALSE, 
+      sizeof(float16),
+      (void*)(sizeof(float16) * first_instance + sizeof(float) * 4 * column)
+    );
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::SetObjectIndexBuffer(unsigned int buffer) {
+  if (!created_) {
+    Create();
+  }
+
+  object_index_vbo_ = buffer;
+  SetVertexLayout();
+}
+
+void DrawVertexMemoryStats(const GeometryArena& arena) {
+  uint32_t vertex_count = arena.GetVertexCount();
+  DrawText(
+    TextFormat(
+      "VERTICES: %u  %u KB  (%u KB AS FLOAT POSITIONS)",
+      vertex_count,
+      kArenaVertexSize * vertex_count / 1024,
+      kPositionVertexSize * vertex_count / 1024
+    ),
+    20,
+    310,
+    24,
+    YELLOW
+  );
+}
@@ -0,0 +1,155 @@
+#ifndef GEOMETRY_ARENA_H_
+#define GEOMETRY_ARENA_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// First fit allocator over [0, capacity) with neighbouring free ranges
+// merged back together on release.
+class RangeAllocator {
+public:
+  explicit RangeAllocator(uint32_t capacity = 0);
+
+  bool Allocate(uint32_t size, uint32_t* offset);
+  void Free(uint32_t offset, uint32_t size);
+  void Grow(uint32_t capacity);
+
+  const uint32_t GetCapacity() const;
+private:
+  // offset -> size
+  std::map<uint32_t, uint32_t> free_;
+  uint32_t capacity_;
+};
+
+// Vertices are stored as 16 bit fractions of a box with a 16 bit material
+// index alongside, 8 bytes in place of a float triple and a separate 32 bit
+// material. Off, the arena keeps the full precision layout.
+constexpr bool kQuantizeVertices = true;
+
+// bytes one vertex takes over every vertex stream of the arena
+constexpr uint32_t kFloatVertexSize = sizeof(float) * 3 + sizeof(uint32_t);
+// a float triple and nothing else, how models were stored before the
+// arena, what the stats overlay and the bake log report savings against
+constexpr uint32_t kPositionVertexSize = sizeof(float) * 3;
+constexpr uint32_t kQuantizedVertexSize = sizeof(uint16_t) * 4;
+constexpr uint32_t kArenaVertexSize = 
+  kQuantizeVertices ? kQuantizedVertexSize : kFloatVertexSize;
+
+// the vertex shaders rebuild a position as offset_ + stored * scale_, with
+// every stored component in [0, 1]
+struct VertexQuantization {
+  Vector3 offset_;
+  Vector3 scale_;
+};
+
+// exactly covers bounds, or the identity when vertices aren't quantized
+const VertexQuantization GetVertexQuantization(const BoundingBox& bounds);
+// the same mapping as a matrix, for paths that fold it into the model one
+const Matrix GetDequantizeMatrix(const VertexQuantization& quantization);
+
+// position_offset and position_scale of a program using the arena
+struct QuantizationUniforms {
+  int offset_loc_;
+  int scale_loc_;
+};
+
+const QuantizationUniforms GetQuantizationUniforms(unsigned int program);
+// expects the program to be in use
+void SetQuantizationUniforms(
+  const QuantizationUniforms& uniforms,
+  const VertexQuantization& quantization
+);
+
+struct ArenaRange {
+  uint32_t first_vertex_;
+  uint32_t vertex_count_;
+
+  // in bytes, always 4 byte aligned
+  uint32_t index_offset_;
+  uint32_t index_size_;
+};
+
+// One vertex buffer, one index buffer and one VAO holding the geometry of
+// every loaded model. Primitives are addressed by base vertex and index
+// offset, so drawing any model only ever needs this VAO bound. A second
+// vertex stream holds each vertex's material palette index.
+class GeometryArena {
+public:
+  GeometryArena();
+  ~GeometryArena();
+
+  GeometryArena(const GeometryArena&) = delete;
+  GeometryArena& operator=(const GeometryArena&) = delete;
+
+  // positions are tightly packed float triples, every vertex of the range
+  // gets the same material. quantization has to cover every position
+  const ArenaRange Allocate(
+    const unsigned char* vertices,
+    uint32_t vertex_count,
+    const unsigned char* indices,
+    uint32_t index_size,
+    uint32_t material,
+    const VertexQuantization& quantization
+  );
+  // same again with a material for each vertex
+  const ArenaRange Allocate(
+    const unsigned char* vertices,
+    uint32_t vertex_count,
+    const unsigned char* indices,
+    uint32_t index_size,
+    const uint32_t* materials,
+    const VertexQuantization& quantization
+  );
+  void Free(const ArenaRange& range);
+
+  // vertices currently allocated, for memory reports
+  const uint32_t GetVertexCount() const;
+
+  void Bind();
+  const unsigned int GetVertexArray() const;
+  // same geometry, with an object index per instance in place of the
+  // instance matrix
+  const unsigned int GetIndirectVertexArray() const;
+
+  // per-instance model matrices for the whole frame, uploaded in one go
+  void UploadInstances(const std::vector<float16>& transforms);
+  // points the instance attributes at transforms[first_instance]
+  void SetInstanceOffset(int first_instance);
+
+  // per-instance object index of the indirect vao, 0 to detach it
+  void SetObjectIndexBuffer(unsigned int buffer);
+private:
+  void Create();
+  void GrowVertices(uint32_t vertex_count);
+  void GrowIndices(uint32_t index_size);
+  void SetVertexLayout();
+  void SetVertexStreams();
+private:
+  bool created_;
+
+  unsigned int vao_;
+  unsigned int indirect_vao_;
+  unsigned int vbo_;
+  unsigned int material_vbo_;
+  unsigned int ebo_;
+  unsigned int instance_vbo_;
+  unsigned int object_index_vbo_;
+
+  int instance_capacity_;
+
+  RangeAllocator vertices_;
+  RangeAllocator indices_;
+
+  uint32_t vertex_count_;
+
+  std::vector<uint32_t> material_staging_;
+  std::vector<uint16_t> vertex_staging_;
+};
+
+void DrawVertexMemoryStats(const GeometryArena& arena);
+
+#endif
@@ -0,0 +1,296 @@
+#include "ImpostorRenderer.h"
+
+#include <glad.h>
+#include <raylib-physfs.h>
+#include <rlgl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "Camera.h"
+
+// assets far enough from the path that a flat stand-in won't be noticed
+static const char* kImpostorAssetPrefixes[] = {
+  "treePine",
+  "mushrooms",
+  "flowers",
+  "stones"
+};
+
+ImpostorRenderer::ImpostorRenderer(LevelEditor& editor) {
+  fade_start_ = kImpostorFadeStart;
+  fade_end_ = kImpostorFadeEnd;
+
+  row_count_ = 0;
+  rows_.resize(editor.GetAssetCount(), -1);
+
+  for (int i = 0; i < rows_.size(); ++i) {
+    const std::string& name = editor.GetAssetName(i);
+    for (const char* prefix : kImpostorAssetPrefixes) {
+      if (name.rfind(prefix, 0) == 0) {
+        rows_[i] = row_count_++;
+        break;
+      }
+    }
+  }
+
+  baked_.resize(row_count_, false);
+  nearest_ = kCameraFar;
+
+  atlas_ = LoadRenderTexture(
+    kImpostorViews * kImpostorTileSize,
+    std::max(row_count_, 1) * kImpostorTileSize
+  );
+  SetTextureFilter(atlas_.texture, TEXTURE_FILTER_BILINEAR);
+
+  bake_shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/model.vert",
+    "assets/shaders/model.frag"
+  );
+  bake_model_loc_ = GetShaderLocation(bake_shader_, "model");
+  bake_quantization_uniforms_ = GetQuantizationUniforms(bake_shader_.id);
+  BindCameraUniformBlock(bake_shader_);
+  BindMaterialPaletteBlock(bake_shader_);
+
+  shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/impostor.vert",
+    "assets/shaders/impostor.frag"
+  );
+  fade_range_loc_ = GetShaderLocation(shader_, "fade_range");
+  atlas_grid_loc_ = GetShaderLocation(shader_, "atlas_grid");
+  atlas_loc_ = GetShaderLocation(shader_, "atlas");
+  BindCameraUniformBlock(shader_);
+
+  glGenVertexArrays(1, &vao_);
+  glGenBuffers(1, &instance_vbo_);
+  instance_capacity_ = 0;
+
+  // the quad corners come from gl_VertexID, only instances need a buffer
+  glBindVertexArray(vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+
+  glVertexAttribPointer(
+    0,
+    4,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(ImpostorInstance),
+    (void*)offsetof(ImpostorInstance, center_)
+  );
+  glVertexAttribPointer(
+    1,
+    4,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(ImpostorInstance),
+    (void*)offsetof(ImpostorInstance, origin_)
+  );
+  glVertexAttribPointer(
+    2,
+    1,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(ImpostorInstance),
+    (void*)offsetof(ImpostorInstance, yaw_)
+  );
+
+  for (int attribute = 0; attribute < 3; ++attribute) {
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribDivisor(attribute, 1);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ImpostorRenderer::~ImpostorRenderer() {
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteBuffers(1, &instance_vbo_);
+
+  UnloadShader(shader_);
+  UnloadShader(bake_shader_);
+  UnloadRenderTexture(atlas_);
+}
+
+void ImpostorRenderer::Bake(
+  LevelEditor& editor,
+  CameraUniforms& camera_uniforms
+) {
+  bool is_rendering = false;
+
+  for (int i = 0; i < rows_.size(); ++i) {
+    int row = rows_[i];
+    if (row < 0 || baked_[row] || !editor.IsAssetLoaded(i)) {
+      continue;
+    }
+
+    if (!is_rendering) {
+      is_rendering = true;
+      BeginTextureMode(atlas_);
+      rlEnableDepthTest();
+      rlEnableScissorTest();
+    }
+
+    ModelComponent& model = editor.GetAsset(i).model_;
+    BoundingBox bounds = model.GetBoundingBox();
+
+    Vector3 center = Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f);
+    float radius = Vector3Distance(bounds.min, bounds.max) * 0.5f;
+
+    baked_[row] = true;
+    if (radius <= 0.f) {
+      continue;
+    }
+
+    // orthographic so the quad can be scaled straight from the bounds
+    Matrix projection =
+      MatrixOrtho(-radius, radius, -radius, radius, 0.01, radius * 4.f);
+
+    for (int view = 0; view < kImpostorViews; ++view) {
+      float angle = 2.f * PI * view / kImpostorViews;
+      Vector3 direction = { sinf(angle), 0.f, cosf(angle) };
+
+      Matrix view_matrix = MatrixLookAt(
+        Vector3Add(center, Vector3Scale(direction, radius * 2.f)),
+        center,
+        Vector3 { 0.f, 1.f, 0.f }
+      );
+      camera_uniforms.Update(view_matrix, projection);
+
+      int x = view * kImpostorTileSize;
+      int y = row * kImpostorTileSize;
+
+      rlViewport(x, y, kImpostorTileSize, kImpostorTileSize);
+      rlScissor(x, y, kImpostorTileSize, kImpostorTileSize);
+      rlClearColor(0, 0, 0, 0);
+      rlClearScreenBuffers();
+
+      model.DrawCustomModel(
+        bake_shader_, 
+        bake_model_loc_, 
+        bake_quantization_uniforms_
+      );
+    }
+  }
+
+  if (is_rendering) {
+    rlDisableScissorTest();
+    rlDisableDepthTest();
+    EndTextureMode();
+  }
+}
+
+void ImpostorRenderer::SetFadeDistances(float start, float end) {
+  fade_start_ = start;
+  fade_end_ = std::max(start, end);
+}
+
+const float ImpostorRenderer::GetFadeStart() const {
+  return fade_start_;
+}
+
+const float ImpostorRenderer::GetFadeEnd() const {
+  return fade_end_;
+}
+
+const bool ImpostorRenderer::HasImpostor(int asset_index) const {
+  return IsImpostorAsset(asset_index) && baked_[rows_[asset_index]];
+}
+
+const bool ImpostorRenderer::IsImpostorAsset(int asset_index) const {
+  return
+    asset_index >= 0 &&
+    asset_index < rows_.size() &&
+    rows_[asset_index] >= 0;
+}
+
+void ImpostorRenderer::Clear() {
+  instances_.clear();
+  nearest_ = kCameraFar;
+}
+
+const bool ImpostorRenderer::Add(
+  int asset_index,
+  const BoundingBox& bounds,
+  Vector3 position,
+  Quaternion rotation,
+  Vector3 eye
+) {
+  if (!HasImpostor(asset_index)) {
+    return false;
+  }
+
+  float distance = Vector3Distance(eye, position);
+  if (distance < fade_start_) {
+    return false;
+  }
+
+  Vector3 center = Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f);
+  Vector3 forward = Vector3RotateByQuaternion({ 0.f, 0.f, 1.f }, rotation);
+
+  instances_.push_back(ImpostorInstance {
+    .center_ = Vector3Add(position, Vector3RotateByQuaternion(center, rotation)),
+    .half_size_ = Vector3Distance(bounds.min, bounds.max) * 0.5f,
+    .origin_ = position,
+    .row_ = (float)rows_[asset_index],
+    .yaw_ = atan2f(forward.x, forward.z)
+  });
+  nearest_ = std::min(nearest_, distance);
+
+  return distance >= fade_end_;
+}
+
+void ImpostorRenderer::Enqueue(RenderQueue& queue) {
+  if (instances_.empty()) {
+    return;
+  }
+
+  int instance_count = instances_.size();
+
+  // orphan the old storage so the driver doesn't stall on last frame's draw
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+  if (instance_count > instance_capacity_) {
+    instance_capacity_ = instance_count;
+  }
+  glBufferData(
+    GL_ARRAY_BUFFER,
+    sizeof(ImpostorInstance) * instance_capacity_,
+    nullptr,
+    GL_STREAM_DRAW
+  );
+  glBufferSubData(
+    GL_ARRAY_BUFFER,
+    0,
+    sizeof(ImpostorInstance) * instance_count,
+    instances_.data()
+  );
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // alpha tested rather than blended, so it sorts with the opaque geometry
+  queue.Add(
+    kOpaqueLayer,
+    this,
+    0,
+    shader_.id,
+    vao_,
+    0,
+    0,
+    instance_count,
+    nearest_
+  );
+}
+
+void ImpostorRenderer::SubmitPacket(const RenderPacket& packet) {
+  glUniform2f(fade_range_loc_, fade_start_, fade_end_);
+  glUniform2f(atlas_grid_loc_, kImpostorViews, std::max(row_count_, 1));
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, atlas_.texture.id);
+  glUniform1i(atlas_loc_, 0);
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, packet.instance_count_);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,94 @@
+#ifndef IMPOSTOR_RENDERER_H_
+#define IMPOSTOR_RENDERER_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <vector>
+
+#include "CameraUniforms.h"
+#include "LevelEditor.h"
+#include "RenderQueue.h"
+
+// views baked around the y axis for every asset
+constexpr int kImpostorViews = 8;
+constexpr int kImpostorTileSize = 128;
+
+// until SetFadeDistances is called
+constexpr float kImpostorFadeStart = 25.f;
+constexpr float kImpostorFadeEnd = 30.f;
+
+struct ImpostorInstance {
+  Vector3 center_;
+  float half_size_;
+  Vector3 origin_;
+  float row_;
+  float yaw_;
+};
+
+// Swaps distant foliage and props for camera facing quads. Every asset's
+// views are baked into one shared atlas, so all impostors on screen go out
+// in a single instanced draw. Between the fade distances the mesh and its
+// impostor are dithered against each other instead of popping.
+class ImpostorRenderer : public RenderSubmitter {
+public:
+  ImpostorRenderer(LevelEditor& editor);
+  ~ImpostorRenderer();
+
+  // renders the atlas rows of any loaded asset that doesn't have one yet,
+  // call outside of BeginMode3D since it changes the camera block
+  void Bake(LevelEditor& editor, CameraUniforms& camera_uniforms);
+
+  void SetFadeDistances(float start, float end);
+  const float GetFadeStart() const;
+  const float GetFadeEnd() const;
+
+  const bool HasImpostor(int asset_index) const;
+  // whether the asset gets an impostor at all, baked yet or not
+  const bool IsImpostorAsset(int asset_index) const;
+
+  void Clear();
+
+  // queues an impostor once the object is far enough away, returns true
+  // when it is past the fade and the mesh doesn't need drawing at all
+  const bool Add(
+    int asset_index,
+    const BoundingBox& bounds,
+    Vector3 position,
+    Quaternion rotation,
+    Vector3 eye
+  );
+
+  // uploads the queued impostors and adds their draw to the queue
+  void Enqueue(RenderQueue& queue);
+
+  void SubmitPacket(const RenderPacket& packet) override;
+private:
+  RenderTexture atlas_;
+  int row_count_;
+
+  // atlas row for each asset index, -1 for assets without an impostor
+  std::vector<int> rows_;
+  std::vector<bool> baked_;
+
+  float fade_start_;
+  float fade_end_;
+
+  Shader bake_shader_;
+  int bake_model_loc_;
+  QuantizationUniforms bake_quantization_uniforms_;
+
+  Shader shader_;
+  int fade_range_loc_;
+  int atlas_grid_loc_;
+  int atlas_loc_;
+
+  unsigned int vao_;
+  unsigned int instance_vbo_;
+  int instance_capacity_;
+
+  std::vector<ImpostorInstance> instances_;
+  float nearest_;
+};
+
+#endif
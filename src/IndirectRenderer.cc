@@ -0,0 +1,480 @@
+#include "IndirectRenderer.h"
+
+#include <glad.h>
+#include <raylib-physfs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "CameraUniforms.h"
+#include "TransformCache.h"
+
+constexpr int kCullGroupSize = 64;
+
+static const unsigned int LoadComputeProgram(const char* filename) {
+  char* source = LoadFileTextFromPhysFS(filename);
+  if (source == nullptr) {
+    std::cout << "WARNING: could not read " << filename << std::endl;
+    return 0;
+  }
+
+  unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+  UnloadFileText(source);
+
+  int status = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::cout << "WARNING: " << filename << ": " << log << std::endl;
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  unsigned int program = glCreateProgram();
+  glAttachShader(program, shader);
+  glLinkProgram(program);
+  glDeleteShader(shader);
+
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    std::cout << "WARNING: could not link " << filename << std::endl;
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  return program;
+}
+
+IndirectRenderer::IndirectRenderer() {
+  supported_ = false;
+  shader_ = { 0 };
+  cull_program_ = 0;
+  arena_ = nullptr;
+  object_count_ = 0;
+  short_command_count_ = 0;
+  int_command_count_ = 0;
+
+  object_buffer_ = 0;
+  command_template_buffer_ = 0;
+  command_buffer_ = 0;
+  visible_buffer_ = 0;
+  draw_list_buffer_ = 0;
+  occlusion_buffer_ = 0;
+
+  // compute and indirect draws with a base instance are both core in 4.3
+  if (!GLAD_GL_VERSION_4_3) {
+    return;
+  }
+
+  cull_program_ = LoadComputeProgram("assets/shaders/cull_indirect.comp");
+  if (cull_program_ == 0) {
+    return;
+  }
+
+  planes_loc_ = glGetUniformLocation(cull_program_, "planes");
+  object_count_loc_ = glGetUniformLocation(cull_program_, "object_count");
+  cull_loc_ = glGetUniformLocation(cull_program_, "cull");
+  occlude_loc_ = glGetUniformLocation(cull_program_, "occlude");
+  occlusion_view_projection_loc_ = 
+    glGetUniformLocation(cull_program_, "occlusion_view_projection");
+  eye_loc_ = glGetUniformLocation(cull_program_, "eye");
+  pixels_per_unit_loc_ = glGetUniformLocation(cull_program_, "pixels_per_unit");
+
+  shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/model_indirect.vert",
+    "assets/shaders/model.frag"
+  );
+  BindCameraUniformBlock(shader_);
+  BindMaterialPaletteBlock(shader_);
+
+  glGenBuffers(1, &object_buffer_);
+  glGenBuffers(1, &command_template_buffer_);
+  glGenBuffers(1, &command_buffer_);
+  glGenBuffers(1, &visible_buffer_);
+  glGenBuffers(1, &draw_list_buffer_);
+  glGenBuffers(1, &occlusion_buffer_);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, occlusion_buffer_);
+  glBufferData(
+    GL_COPY_WRITE_BUFFER,
+    sizeof(float) * kOcclusionWidth * kOcclusionHeight,
+    nullptr,
+    GL_STREAM_DRAW
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  supported_ = true;
+}
+
+IndirectRenderer::~IndirectRenderer() {
+  if (!supported_) {
+    return;
+  }
+
+  if (arena_ != nullptr) {
+    arena_->SetObjectIndexBuffer(0);
+  }
+
+  glDeleteBuffers(1, &object_buffer_);
+  glDeleteBuffers(1, &command_template_buffer_);
+  glDeleteBuffers(1, &command_buffer_);
+  glDeleteBuffers(1, &visible_buffer_);
+  glDeleteBuffers(1, &draw_list_buffer_);
+  glDeleteBuffers(1, &occlusion_buffer_);
+
+  glDeleteProgram(cull_program_);
+  UnloadShader(shader_);
+}
+
+const bool IndirectRenderer::IsSupported() const {
+  return supported_;
+}
+
+void IndirectRenderer::Clear() {
+  object_count_ = 0;
+  short_command_count_ = 0;
+  int_command_count_ = 0;
+  batched_assets_.clear();
+}
+
+static void UploadBuffer(unsigned int buffer, const void* data, size_t size) {
+  // never zero sized, so an empty level still has valid bindings
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(
+    GL_COPY_WRITE_BUFFER,
+    std::max(size, sizeof(uint32_t)),
+    nullptr,
+    GL_STATIC_DRAW
+  );
+  if (size > 0) {
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void IndirectRenderer::Build(
+  LevelEditor& editor,
+  const std::vector<LevelMesh>& meshes,
+  const ImpostorRenderer& impostors
+) {
+  Clear();
+  if (!supported_) {
+    return;
+  }
+
+  arena_ = &editor.GetGeometryArena();
+  batched_assets_.assign(editor.GetAssetCount(), false);
+
+  std::vector<int> asset_objects(batched_assets_.size(), 0);
+
+  // same rule as the static batch, impostor assets keep their fade
+  for (const LevelMesh& mesh : meshes) {
+    int asset_index = mesh.index_;
+    if (
+      asset_index < 0 ||
+      asset_index >= batched_assets_.size() ||
+      impostors.IsImpostorAsset(asset_index) ||
+      editor.GetAsset(asset_index).model_.GetCustomMeshes() == nullptr
+    ) {
+      continue;
+    }
+
+    batched_assets_[asset_index] = true;
+    ++asset_objects[asset_index];
+  }
+
+  std::vector<int> asset_lod_counts(batched_assets_.size(), 1);
+  for (int i = 0; i < batched_assets_.size(); ++i) {
+    if (batched_assets_[i]) {
+      asset_lod_counts[i] = std::max(
+        (int)editor.GetAsset(i).model_.GetCustomLodErrors()->size(), 
+        1
+      );
+    }
+  }
+
+  // one command per primitive and lod, each with room for every object of
+  // its asset. an object only ever lands in one lod's commands
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<std::vector<std::vector<uint32_t>>> asset_commands(
+    batched_assets_.size()
+  );
+  uint32_t instance_count = 0;
+
+  for (unsigned int index_type : { GL_UNSIGNED_SHORT, GL_UNSIGNED_INT }) {
+    uint32_t index_stride =
+      index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    for (int i = 0; i < batched_assets_.size(); ++i) {
+      if (!batched_assets_[i]) {
+        continue;
+      }
+
+      const std::vector<CustomMesh>& custom_meshes =
+        *editor.GetAsset(i).model_.GetCustomMeshes();
+      asset_commands[i].resize(asset_lod_counts[i]);
+
+      for (int lod = 0; lod < asset_lod_counts[i]; ++lod) {
+        for (const CustomMesh& mesh : custom_meshes) {
+          for (int j = 0; j < mesh.ranges_.size(); ++j) {
+            if (mesh.index_type_[j] != index_type) {
+              continue;
+            }
+
+            // primitives that simplified less stay on their coarsest level
+            const std::vector<CustomLod>& lods = mesh.lods_[j];
+            const CustomLod& primitive_lod = 
+              lods[std::min(lod, (int)lods.size() - 1)];
+
+            asset_commands[i][lod].push_back(commands.size());
+            commands.push_back(DrawElementsIndirectCommand {
+              .count_ = (uint32_t)primitive_lod.index_count_,
+              .instance_count_ = 0,
+              .first_index_ = primitive_lod.index_offset_ / index_stride,
+              .base_vertex_ = (int32_t)mesh.ranges_[j].first_vertex_,
+              .base_instance_ = instance_count
+            });
+            instance_count += asset_objects[i];
+          }
+        }
+      }
+    }
+
+    if (index_type == GL_UNSIGNED_SHORT) {
+      short_command_count_ = commands.size();
+    }
+  }
+  int_command_count_ = commands.size() - short_command_count_;
+
+  // every lod has the same number of commands, they follow each other
+  std::vector<uint32_t> draw_list;
+  std::vector<uint32_t> asset_first_draw(batched_assets_.size(), 0);
+  for (int i = 0; i < batched_assets_.size(); ++i) {
+    asset_first_draw[i] = draw_list.size();
+    for (const std::vector<uint32_t>& lod_commands : asset_commands[i]) {
+      draw_list.insert(
+        draw_list.end(),
+        lod_commands.cbegin(),
+        lod_commands.cend()
+      );
+    }
+  }
+
+  std::vector<IndirectObject> objects;
+  for (const LevelMesh& mesh : meshes) {
+    if (!IsBatched(mesh.index_)) {
+      continue;
+    }
+
+    const ModelComponent& model = editor.GetAsset(mesh.index_).model_;
+    const std::vector<float>& lod_errors = *model.GetCustomLodErrors();
+
+    // one draw covers many assets, so each object carries its own
+    // dequantization instead of a uniform
+    Matrix transform = MatrixMultiply(
+      GetDequantizeMatrix(model.GetVertexQuantization()),
+      ComposeTransform(mesh.pos_, mesh.rotation_)
+    );
+
+    BoundingBox bounds = model.GetBoundingBox();
+    Vector3 center = Vector3Add(
+      Vector3RotateByQuaternion(
+        Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f),
+        mesh.rotation_
+      ),
+      mesh.pos_
+    );
+
+    IndirectObject object = {
+      .transform_ = MatrixToFloatV(transform),
+      .sphere_ = {
+        center.x,
+        center.y,
+        center.z,
+        Vector3Distance(bounds.min, bounds.max) * 0.5f
+      },
+      .lod_errors_ = { 0.f },
+      .first_draw_ = asset_first_draw[mesh.index_],
+      .draw_count_ = (uint32_t)asset_commands[mesh.index_][0].size(),
+      .lod_count_ = (uint32_t)asset_lod_counts[mesh.index_],
+      .padding_ = { 0, 0 }
+    };
+    for (int lod = 0; lod < lod_errors.size() && lod < kMaxMeshLods; ++lod) {
+      object.lod_errors_[lod] = lod_errors[lod];
+    }
+
+    objects.push_back(object);
+  }
+  object_count_ = objects.size();
+
+  UploadBuffer(
+    object_buffer_,
+    objects.data(),
+    sizeof(IndirectObject) * objects.size()
+  );
+  UploadBuffer(
+    command_template_buffer_,
+    commands.data(),
+    sizeof(DrawElementsIndirectCommand) * commands.size()
+  );
+  UploadBuffer(
+    command_buffer_,
+    commands.data(),
+    sizeof(DrawElementsIndirectCommand) * commands.size()
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, visible_buffer_);
+  glBufferData(
+    GL_COPY_WRITE_BUFFER,
+    sizeof(uint32_t) * std::max(instance_count, 1u),
+    nullptr,
+    GL_DYNAMIC_COPY
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  UploadBuffer(
+    draw_list_buffer_,
+    draw_list.data(),
+    sizeof(uint32_t) * draw_list.size()
+  );
+
+  arena_->SetObjectIndexBuffer(visible_buffer_);
+}
+
+const bool IndirectRenderer::IsBatched(int asset_index) const {
+  return
+    asset_index >= 0 &&
+    asset_index < batched_assets_.size() &&
+    batched_assets_[asset_index];
+}
+
+void IndirectRenderer::Enqueue(
+  RenderQueue& queue, 
+  const ViewCuller& culler, 
+  const OcclusionCuller& occlusion,
+  FlyCamera& camera
+) {
+  if (!supported_ || object_count_ == 0) {
+    return;
+  }
+
+  // reset the instance counts without the commands ever leaving the GPU
+  glBindBuffer(GL_COPY_READ_BUFFER, command_template_buffer_);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer_);
+  glCopyBufferSubData(
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    0,
+    0,
+    sizeof(DrawElementsIndirectCommand) *
+      (short_command_count_ + int_command_count_)
+  );
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  float planes[kPlaneCount * 4];
+  const Frustum& frustum = culler.GetFrustum();
+  for (int i = 0; i < kPlaneCount; ++i) {
+    planes[i * 4 + 0] = frustum.planes_[i].normal_.x;
+    planes[i * 4 + 1] = frustum.planes_[i].normal_.y;
+    planes[i * 4 + 2] = frustum.planes_[i].normal_.z;
+    planes[i * 4 + 3] = frustum.planes_[i].distance_;
+  }
+
+  glUseProgram(cull_program_);
+  glUniform4fv(planes_loc_, kPlaneCount, planes);
+  glUniform1ui(object_count_loc_, object_count_);
+  glUniform1i(cull_loc_, culler.IsEnabled());
+
+  // same as the instanced path, pixels one world unit covers at a distance
+  // of one unit
+  CameraComponent& view = camera.GetCamera();
+  Vector3 eye = view.GetPosition();
+  glUniform3f(eye_loc_, eye.x, eye.y, eye.z);
+  glUniform1f(
+    pixels_per_unit_loc_, 
+    GetScreenHeight() / (2.f * tanf(view.GetFOV() * DEG2RAD * 0.5f))
+  );
+
+  bool occlude = occlusion.IsValid();
+  glUniform1i(occlude_loc_, occlude);
+  if (occlude) {
+    const std::vector<float>& depth = occlusion.GetDepth();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, occlusion_buffer_);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER, 
+      0, 
+      sizeof(float) * depth.size(), 
+      depth.data()
+    );
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glUniformMatrix4fv(
+      occlusion_view_projection_loc_, 
+      1, 
+      GL_FALSE, 
+      MatrixToFloatV(occlusion.GetViewProjection()).v
+    );
+  }
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, object_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, command_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visible_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, draw_list_buffer_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, occlusion_buffer_);
+
+  glDispatchCompute(
+    (object_count_ + kCullGroupSize - 1) / kCullGroupSize,
+    1,
+    1
+  );
+
+  // the draws read the counts as commands and the indices as attributes
+  glMemoryBarrier(
+    GL_COMMAND_BARRIER_BIT |
+    GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+    GL_SHADER_STORAGE_BARRIER_BIT
+  );
+  glUseProgram(0);
+
+  queue.Add(
+    kOpaqueLayer,
+    this,
+    0,
+    shader_.id,
+    arena_->GetIndirectVertexArray(),
+    0,
+    0,
+    object_count_,
+    0.f
+  );
+}
+
+void IndirectRenderer::SubmitPacket(const RenderPacket& packet) {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, object_buffer_);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+
+  if (short_command_count_ > 0) {
+    glMultiDrawElementsIndirect(
+      GL_TRIANGLES,
+      GL_UNSIGNED_SHORT,
+      nullptr,
+      short_command_count_,
+      0
+    );
+  }
+
+  if (int_command_count_ > 0) {
+    glMultiDrawElementsIndirect(
+      GL_TRIANGLES,
+      GL_UNSIGNED_INT,
+      (void*)(sizeof(DrawElementsIndirectCommand) * short_command_count_),
+      int_command_count_,
+      0
+    );
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
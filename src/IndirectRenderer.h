@@ -0,0 +1,109 @@
+#ifndef INDIRECT_RENDERER_H_
+#define INDIRECT_RENDERER_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+#include "FlyCamera.h"
+#include "GeometryArena.h"
+#include "ImpostorRenderer.h"
+#include "LevelEditor.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+
+// laid out to match the std430 structs in the shaders
+struct IndirectObject {
+  float16 transform_;
+  // world space bounding sphere, radius in w
+  Vector4 sphere_;
+  // the asset's CustomModel::GetLodErrors, the first lod_count_ are used
+  float lod_errors_[kMaxMeshLods];
+  uint32_t first_draw_;
+  // commands per lod, the lods follow each other in the draw list
+  uint32_t draw_count_;
+  uint32_t lod_count_;
+  uint32_t padding_[2];
+};
+
+struct DrawElementsIndirectCommand {
+  uint32_t count_;
+  uint32_t instance_count_;
+  uint32_t first_index_;
+  int32_t base_vertex_;
+  uint32_t base_instance_;
+};
+
+// GPU driven path for GL 4.3 contexts. Level meshes live in storage
+// buffers uploaded once per level, a compute pass culls them against the
+// frustum and fills in the instance counts of one draw command per asset
+// primitive and lod, and the frame goes out in a multi-draw per index
+// type. The pass picks each object's lod the same way the instanced path
+// does, from its distance and the model's lod errors. When
+// the occlusion buffer is valid it is uploaded as well and each object's
+// bounding sphere is tested against it in the same pass. What
+// the CPU does per frame doesn't depend on how many objects there are.
+// IsSupported is false on older contexts and everything stays on the
+// instanced and static batch paths.
+class IndirectRenderer : public RenderSubmitter {
+public:
+  IndirectRenderer();
+  ~IndirectRenderer();
+
+  const bool IsSupported() const;
+
+  void Build(
+    LevelEditor& editor,
+    const std::vector<LevelMesh>& meshes,
+    const ImpostorRenderer& impostors
+  );
+  void Clear();
+
+  // whether meshes of this asset are drawn here since the last build
+  const bool IsBatched(int asset_index) const;
+
+  // runs the cull pass and queues the draw
+  void Enqueue(
+    RenderQueue& queue, 
+    const ViewCuller& culler, 
+    const OcclusionCuller& occlusion,
+    FlyCamera& camera
+  );
+
+  void SubmitPacket(const RenderPacket& packet) override;
+private:
+  bool supported_;
+
+  Shader shader_;
+  unsigned int cull_program_;
+  int planes_loc_;
+  int object_count_loc_;
+  int cull_loc_;
+  int occlude_loc_;
+  int occlusion_view_projection_loc_;
+  int eye_loc_;
+  int pixels_per_unit_loc_;
+
+  GeometryArena* arena_;
+
+  unsigned int object_buffer_;
+  // commands with zeroed instance counts, copied over the live ones
+  unsigned int command_template_buffer_;
+  unsigned int command_buffer_;
+  unsigned int visible_buffer_;
+  unsigned int draw_list_buffer_;
+  // the occlusion culler's depth, uploaded on frames it is valid
+  unsigned int occlusion_buffer_;
+
+  int object_count_;
+  // commands are sorted so the 16 bit ones come first
+  int short_command_count_;
+  int int_command_count_;
+
+  std::vector<bool> batched_assets_;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "InstancedRenderer.h"
+
+#include <glad.h>
+#include <raylib-physfs.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "CameraUniforms.h"
+#include "TransformCache.h"
+
+InstancedRenderer::InstancedRenderer() {
+  shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/model_instanced.vert",
+    "assets/shaders/model_instanced.frag"
+  );
+
+  uniform_fade_range_ = GetShaderLocation(shader_, "fade_range");
+  quantization_uniforms_ = GetQuantizationUniforms(shader_.id);
+
+  BindCameraUniformBlock(shader_);
+  BindMaterialPaletteBlock(shader_);
+
+  arena_ = nullptr;
+  fade_range_ = { 0.f, 0.f };
+}
+
+InstancedRenderer::~InstancedRenderer() {
+  UnloadShader(shader_);
+}
+
+void InstancedRenderer::Clear() {
+  // keep the inner vectors around so their capacity is reused next frame
+  for (std::vector<float16>& transforms : instances_) {
+    transforms.clear();
+  }
+}
+
+void InstancedRenderer::Add(
+  int asset_index,
+  Vector3 position,
+  Quaternion rotation,
+  Vector3 scale
+) {
+  Add(
+    asset_index, 
+    MatrixToFloatV(ComposeTransform(position, rotation, scale))
+  );
+}
+
+void InstancedRenderer::Add(int asset_index, const float16& transform) {
+  if (asset_index < 0) {
+    return;
+  }
+
+  if (asset_index >= instances_.size()) {
+    instances_.resize(asset_index + 1);
+  }
+
+  instances_[asset_index].push_back(transform);
+}
+
+static const float GetInstanceScale(const float16& transform) {
+  // longest basis vector, the error of a scaled model grows with it
+  float scale = 0.f;
+  for (int column = 0; column < 3; ++column) {
+    const float* axis = &transform.v[column * 4];
+    scale = std::max(
+      scale, 
+      sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2])
+    );
+  }
+
+  return scale;
+}
+
+void InstancedRenderer::Enqueue(
+  RenderQueue& queue,
+  LevelEditor& editor, 
+  FlyCamera& camera, 
+  const ImpostorRenderer& impostors
+) {
+  CameraComponent& view = camera.GetCamera();
+  Vector3 eye = view.GetPosition();
+
+  // pixels covered by one world unit at a distance of one unit
+  float pixels_per_unit = 
+    GetScreenHeight() / (2.f * tanf(view.GetFOV() * DEG2RAD * 0.5f));
+
+  frame_instances_.clear();
+  batches_.clear();
+
+  for (int i = 0; i < instances_.size(); ++i) {
+    if (instances_[i].empty()) {
+      continue;
+    }
+
+    ModelComponent& model = editor.GetAsset(i).model_;
+
+    for (int lod = 0; lod < kMaxMeshLods; ++lod) {
+      lod_instances_[lod].clear();
+      lod_depths_[lod] = kCameraFar;
+    }
+
+    for (const float16& transform : instances_[i]) {
+      Vector3 position = { transform.v[12], transform.v[13], transform.v[14] };
+      float distance = std::max(Vector3Distance(eye, position), kCameraNear);
+
+      int lod = model.SelectCustomModelLod(
+        pixels_per_unit * GetInstanceScale(transform) / distance
+      );
+      lod_instances_[lod].push_back(transform);
+      lod_depths_[lod] = std::min(lod_depths_[lod], distance);
+    }
+
+    for (int lod = 0; lod < kMaxMeshLods; ++lod) {
+      if (lod_instances_[lod].empty()) {
+        continue;
+      }
+
+      batches_.push_back(InstanceBatch {
+        .asset_index_ = i,
+        .model_ = &model,
+        .lod_ = lod,
+        .first_instance_ = (int)(frame_instances_.size()),
+        .instance_count_ = (int)lod_instances_[lod].size(),
+        .depth_ = lod_depths_[lod],
+        .fades_ = impostors.HasImpostor(i)
+      });
+
+      frame_instances_.insert(
+        frame_instances_.end(), 
+        lod_instances_[lod].cbegin(), 
+        lod_instances_[lod].cend()
+      );
+    }
+  }
+
+  if (frame_instances_.empty()) {
+    return;
+  }
+
+  GeometryArena& arena = editor.GetGeometryArena();
+  arena.UploadInstances(frame_instances_);
+
+  arena_ = &arena;
+  fade_range_ = { impostors.GetFadeStart(), impostors.GetFadeEnd() };
+
+  for (int i = 0; i < batches_.size(); ++i) {
+    const InstanceBatch& batch = batches_[i];
+    queue.Add(
+      kOpaqueLayer,
+      this,
+      i,
+      shader_.id,
+      arena.GetVertexArray(),
+      batch.asset_index_,
+      batch.first_instance_,
+      batch.instance_count_,
+      batch.depth_
+    );
+  }
+}
+
+void InstancedRenderer::SubmitPacket(const RenderPacket& packet) {
+  const InstanceBatch& batch = batches_[packet.index_];
+
+  if (batch.fades_) {
+    glUniform2f(uniform_fade_range_, fade_range_.x, fade_range_.y);
+  } else {
+    glUniform2f(uniform_fade_range_, 0.f, 0.f);
+  }
+
+  SetQuantizationUniforms(
+    quantization_uniforms_, 
+    batch.model_->GetVertexQuantization()
+  );
+
+  arena_->SetInstanceOffset(batch.first_instance_);
+  batch.model_->DrawCustomModelInstanced(batch.instance_count_, batch.lod_);
+}
@@ -0,0 +1,80 @@
+#ifndef INSTANCED_RENDERER_H_
+#define INSTANCED_RENDERER_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <vector>
+
+#include "FlyCamera.h"
+#include "ImpostorRenderer.h"
+#include "LevelEditor.h"
+#include "RenderQueue.h"
+
+struct InstanceBatch {
+  int asset_index_;
+  // resolved while enqueueing, looking an asset up can load it and grow
+  // the arena, which must not happen once the queue is submitting
+  ModelComponent* model_;
+  int lod_;
+  int first_instance_;
+  int instance_count_;
+  // nearest instance, what the batch is sorted by in the queue
+  float depth_;
+  // dithered against its impostor over the fade range
+  bool fades_;
+};
+
+// Buckets level objects by asset index so every asset is drawn with one
+// instanced call per primitive, no matter how many times it is placed.
+// All transforms for the frame go up in a single upload into the arena.
+// Each bucket is split again by the lod its instances are far enough away
+// for, and assets with an impostor dither out over its fade distances.
+// Batches go out through the render queue rather than being drawn in place.
+class InstancedRenderer : public RenderSubmitter {
+public:
+  InstancedRenderer();
+  ~InstancedRenderer();
+
+  void Clear();
+
+  void Add(
+    int asset_index,
+    Vector3 position,
+    Quaternion rotation = QuaternionIdentity(),
+    Vector3 scale = { 1.0, 1.0, 1.0 }
+  );
+  // an already composed world matrix, e.g. from a TransformCache
+  void Add(int asset_index, const float16& transform);
+
+  // uploads the frame's transforms and queues one packet per batch
+  void Enqueue(
+    RenderQueue& queue,
+    LevelEditor& editor, 
+    FlyCamera& camera, 
+    const ImpostorRenderer& impostors
+  );
+
+  void SubmitPacket(const RenderPacket& packet) override;
+private:
+  Shader shader_;
+
+  int uniform_fade_range_;
+  QuantizationUniforms quantization_uniforms_;
+
+  // indexed by asset index, holds column major model matrices
+  std::vector<std::vector<float16>> instances_;
+
+  // every bucket back to back, uploaded once per frame
+  std::vector<float16> frame_instances_;
+  std::vector<InstanceBatch> batches_;
+
+  // only valid between Enqueue and the queue's Submit
+  GeometryArena* arena_;
+  Vector2 fade_range_;
+
+  std::vector<float16> lod_instances_[kMaxMeshLods];
+  float lod_depths_[kMaxMeshLods];
+};
+
+#endif
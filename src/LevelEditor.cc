@@ -2,21 +2,35 @@
 
 #include <raylib-physfs.h>
 #include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
 #include <string>
 
-LevelEditor::LevelEditor() {
+LevelEditor::LevelEditor(AssetResidency residency) {
   model_cursor_pos_ = Vector3Zero();
   prev_cursor_pos_ = Vector3Zero();
   rot_angle_ = 0.f;
 
+  residency_ = residency;
 
   FilePathList model_paths = LoadDirectoryFilesFromPhysFS("assets/models");
-  
+
   for (int i = 0; i < model_paths.count; ++i) {
-    assets_.emplace_back(LevelAsset {
-      ModelComponent(model_paths.paths[i], WHITE, true),
-      LoadRenderTexture(100, 100),     
-    });
+    asset_filenames_.push_back(model_paths.paths[i]);
+  }
+
+  UnloadDirectoryFiles(model_paths);
+
+  assets_.resize(asset_filenames_.size());
+
+  if (residency_ == AssetResidency::kAll) {
+    std::vector<int> indices;
+    for (int i = 0; i < assets_.size(); ++i) {
+      indices.push_back(i);
+      assets_[i].thumbnail_ = LoadRenderTexture(100, 100);
+    }
+    LoadAssets(indices);
   }
 
   snap_ = Snap::kNone;
@@ -244,51 +258,47 @@ void LevelEditor::PlaceObjects(
   }
 }
 
-void LevelEditor::DrawObjectBounds(const LevelMesh& mesh) {
+void LevelEditor::DrawObjectBounds(
+  const LevelMesh& mesh, 
+  DebugDraw& debug_draw
+) {
   BoundingBox bounding_box = assets_[mesh.index_].model_.GetBoundingBox(); 
-     
-  // min start
-  Vector3 p1 = Vector3Add(mesh.pos_, bounding_box.min);
-  // max start
-  Vector3 p2 = Vector3Add(mesh.pos_, bounding_box.max);
-
-  Vector3 p3 = { p2.x, p1.y, p2.z };
-  Vector3 p4 = { p1.x, p1.y, p2.z };
-  Vector3 p5 = { p2.x, p1.y, p1.z };
-
-  Vector3 p6 = { p1.x, p2.y, p2.z };
-  Vector3 p7 = { p1.x, p2.y, p1.z };
-  Vector3 p8 = { p2.x, p2.y, p1.z }; 
-    
-  DrawLine3D(p1, p5, GREEN);
-  DrawLine3D(p1, p4, GREEN);
-  DrawLine3D(p4, p3, GREEN);
-  DrawLine3D(p3, p5, GREEN);
-
-  DrawLine3D(p5, p8, GREEN);
-  DrawLine3D(p4, p6, GREEN);
-  DrawLine3D(p1, p7, GREEN);
-  DrawLine3D(p2, p3, GREEN);
 
-  DrawLine3D(p7, p8, GREEN);
-  DrawLine3D(p7, p6, GREEN);
-  DrawLine3D(p6, p2, GREEN);
-  DrawLine3D(p2, p8, GREEN);
+  debug_draw.AddBox(
+    BoundingBox {
+      .min = Vector3Add(mesh.pos_, bounding_box.min),
+      .max = Vector3Add(mesh.pos_, bounding_box.max)
+    },
+    GREEN
+  );
 }
 
-void LevelEditor::DrawAsset(const LevelMesh& mesh, bool play_mode) {
+void LevelEditor::DrawAsset(
+  const LevelMesh& mesh, 
+  bool play_mode, 
+  DebugDraw& debug_draw
+) {
   assets_[mesh.index_].model_.Draw(
     mesh.pos_, 
     { 1.0, 1.0, 1.0 }, 
     mesh.rotation_
   );
 
-  if (mesh.selected_) {
-    DrawObjectBounds(mesh);
+  if (mesh.selected_ || (IsKeyDown(KEY_C) && !play_mode)) {
+    DrawObjectBounds(mesh, debug_draw);
   }
+}
+
+void LevelEditor::DrawMeshBounds(
+  const std::vector<LevelMesh>& meshes, 
+  DebugDraw& debug_draw
+) {
+  bool draw_all = IsKeyDown(KEY_C);
 
-  if (IsKeyDown(KEY_C) && !play_mode) {
-    DrawObjectBounds(mesh);
+  for (const LevelMesh& mesh : meshes) {
+    if (mesh.selected_ || draw_all) {
+      DrawObjectBounds(mesh, debug_draw);
+    }
   }
 }
 
@@ -297,7 +307,11 @@ void LevelEditor::DrawCoins(const LevelCoin& coin) {
   model.model_.Draw(coin.pos_, { 1.0, 1.0, 1.0 }, coin.rotation_);  
 }
 
-void LevelEditor::SelectObject(LevelMesh& mesh, FlyCamera& camera) {
+void LevelEditor::SelectObject(
+  LevelMesh& mesh, 
+  FlyCamera& camera, 
+  DebugDraw& debug_draw
+) {
   BoundingBox bounding_box = assets_[mesh.index_].model_.GetBoundingBox(); 
      
   // min start
@@ -327,29 +341,29 @@ void LevelEditor::SelectObject(LevelMesh& mesh, FlyCamera& camera) {
     Vector3 y_axis = Vector3Add(mesh.pos_, { 0.0, 3.0, 0.0 });
     Vector3 z_axis = Vector3Add(mesh.pos_, { 0.0, 0.0, 3.0 });
 
-    DrawLine3D(mesh.pos_, y_axis, BLUE);
-    DrawLine3D(mesh.pos_, x_axis, RED);
-    DrawLine3D(mesh.pos_, z_axis, GREEN);
+    debug_draw.AddLine(mesh.pos_, y_axis, BLUE);
+    debug_draw.AddLine(mesh.pos_, x_axis, RED);
+    debug_draw.AddLine(mesh.pos_, z_axis, GREEN);
 
     if (GetRayCollisionSphere(mouse_ray, x_axis, 0.1f).hit) {
       selection_snap_ = Snap::kSnapX;
-      DrawSphere(x_axis, 0.1f, RED);
+      debug_draw.AddSphere(x_axis, 0.1f, RED);
     } else {
-      DrawSphere(x_axis, 0.1f, Color { 100, 0, 0, 255 });
+      debug_draw.AddSphere(x_axis, 0.1f, Color { 100, 0, 0, 255 });
     }
 
     if (GetRayCollisionSphere(mouse_ray, y_axis, 0.1f).hit) {
       selection_snap_ = Snap::kSnapY;
-      DrawSphere(y_axis, 0.1f, BLUE);
+      debug_draw.AddSphere(y_axis, 0.1f, BLUE);
     } else {
-      DrawSphere(y_axis, 0.1f, DARKBLUE);
+      debug_draw.AddSphere(y_axis, 0.1f, DARKBLUE);
     }
 
     if (GetRayCollisionSphere(mouse_ray, z_axis, 0.1f).hit) {
       selection_snap_ = Snap::kSnapZ;
-      DrawSphere(z_axis, 0.1f, GREEN); 
+      debug_draw.AddSphere(z_axis, 0.1f, GREEN); 
     } else {
-      DrawSphere(z_axis, 0.1f, DARKGREEN); 
+      debug_draw.AddSphere(z_axis, 0.1f, DARKGREEN); 
     }
 
     if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
@@ -435,6 +449,10 @@ void LevelEditor::SelectionMove(
 
 
 void LevelEditor::UpdateThumbnails() {
+  if (residency_ != AssetResidency::kAll) {
+    return;
+  }
+
   for (LevelAsset& mesh : assets_) {
       Camera3D thumbnail_camera {
         .position = { 0.0, 1.0, -1.f },
@@ -472,7 +490,7 @@ void LevelEditor::UpdateThumbnails() {
     }
 }
 
-void LevelEditor::PlacePlayer(FlyCamera& camera) {
+void LevelEditor::PlacePlayer(FlyCamera& camera, DebugDraw& debug_draw) {
   if (IsKeyPressed(KEY_P) && !IsCoinMode()) {
     set_player_ = !set_player_;
   }
@@ -507,20 +525,18 @@ void LevelEditor::PlacePlayer(FlyCamera& camera) {
     else if (player_angle_ == 270.0f)
       dir_end = Vector3Add(dir, { 0.0, 0.0, -1.0 });
 
-    DrawCapsule(pos, Vector3Add(pos, { 0.0, 0.5, 0.0 }), 0.1, 8, 8, BLUE); 
-    DrawLine3D(dir, dir_end, GREEN);
+    debug_draw.AddCapsule(pos, Vector3Add(pos, { 0.0, 0.5, 0.0 }), 0.1, BLUE); 
+    debug_draw.AddLine(dir, dir_end, GREEN);
 
     if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
       player_position_ = pos;
       set_player_ = false;
     }
   } else {
-    DrawCapsule(
+    debug_draw.AddCapsule(
       player_position_, 
       Vector3Add(player_position_, { 0.0, 0.5, 0.0 }), 
       0.1, 
-      8, 
-      8, 
       BLUE
     ); 
 
@@ -536,7 +552,7 @@ void LevelEditor::PlacePlayer(FlyCamera& camera) {
     else if (player_angle_ == 270.0f)
       dir_end = Vector3Add(dir, { 0.0, 0.0, -1.0 });
 
-    DrawLine3D(dir, dir_end, GREEN);
+    debug_draw.AddLine(dir, dir_end, GREEN);
   }
 }
 
@@ -810,6 +826,8 @@ void LevelEditor::Load(
       }
     }
   }    
+
+  UpdateResidency(meshes, coins);
 }  
 
 const std::string& LevelEditor::GetCurrentFileSaveName() const {
@@ -822,7 +840,116 @@ const std::string& LevelEditor::GetCurrentLoadedFileSaveName() const {
 
 
 LevelAsset& LevelEditor::GetAsset(int index) {
-  return assets_[index];
+  LevelAsset& asset = assets_[index];
+
+  if (!asset.model_.IsLoaded() && !asset.load_failed_) {
+    ModelData data;
+    LoadModelData(asset_filenames_[index].c_str(), &data);
+    asset.model_.Upload(data, arena_, palette_);
+    palette_.Upload();
+
+    CheckAssetLoaded(index);
+  }
+
+  return asset;
+}
+
+void LevelEditor::CheckAssetLoaded(int index) {
+  LevelAsset& asset = assets_[index];
+  if (asset.model_.IsLoaded()) {
+    return;
+  }
+
+  asset.load_failed_ = true;
+  std::cout << "WARNING: could not load " << asset_filenames_[index] 
+    << std::endl;
+}
+
+const bool LevelEditor::IsAssetLoaded(int index) const {
+  return assets_[index].model_.IsLoaded();
+}
+
+const int LevelEditor::GetAssetCount() const {
+  return assets_.size();
+}
+
+const std::string& LevelEditor::GetAssetName(int index) const {
+  return asset_filenames_[index];
+}
+
+GeometryArena& LevelEditor::GetGeometryArena() {
+  return arena_;
+}
+
+MaterialPalette& LevelEditor::GetMaterialPalette() {
+  return palette_;
+}
+
+void LevelEditor::LoadAssets(const std::vector<int>& indices) {
+  if (indices.empty()) {
+    return;
+  }
+
+  // decode on every core, then upload on this thread. results are matched
+  // back to their slot by index so mesh indices never shift
+  std::vector<std::future<std::unique_ptr<ModelData>>> decoded;
+
+  for (int index : indices) {
+    std::string filename = asset_filenames_[index];
+    decoded.push_back(loader_pool_.Submit([filename]() {
+      std::unique_ptr<ModelData> data = std::make_unique<ModelData>();
+      LoadModelData(filename.c_str(), data.get());
+      return data;
+    }));
+  }
+
+  for (int i = 0; i < indices.size(); ++i) {
+    std::unique_ptr<ModelData> data = decoded[i].get();
+    assets_[indices[i]].model_.Upload(*data, arena_, palette_);
+    CheckAssetLoaded(indices[i]);
+  }
+
+  palette_.Upload();
+}
+
+void LevelEditor::UpdateResidency(
+  const std::vector<LevelMesh>& meshes,
+  const std::vector<LevelCoin>& coins
+) {
+  if (residency_ != AssetResidency::kLevel) {
+    return;
+  }
+
+  std::vector<bool> referenced(assets_.size(), false);
+  referenced[kFlagModelIndex] = true;
+
+  for (const LevelMesh& mesh : meshes) {
+    if (mesh.index_ >= 0 && mesh.index_ < assets_.size()) {
+      referenced[mesh.index_] = true;
+    }
+  }
+
+  for (const LevelCoin& coin : coins) {
+    if (coin.index_ >= 0 && coin.index_ < assets_.size()) {
+      referenced[coin.index_] = true;
+    }
+  }
+
+  std::vector<int> missing;
+
+  for (int i = 0; i < assets_.size(); ++i) {
+    if (
+      referenced[i] && 
+      !assets_[i].model_.IsLoaded() && 
+      !assets_[i].load_failed_
+    ) {
+      missing.push_back(i);
+    } else if (!referenced[i] && assets_[i].model_.IsLoaded()) {
+      assets_[i].model_.Unload();
+    }
+  }
+
+  LoadAssets(missing);
 }
 
 const bool LevelEditor::IsCoinMode() const {
@@ -6,14 +6,20 @@
 
 #include <vector>
 
+#include "DebugDraw.h"
 #include "FlyCamera.h"
+#include "GeometryArena.h"
+#include "MaterialPalette.h"
 #include "Model.h"
+#include "ThreadPool.h"
 
 #define NO_SELECTED_ASSET -1
 
 struct LevelAsset {
   ModelComponent model_;
   RenderTexture thumbnail_;
+  // the model couldn't be read or uploaded, it isn't tried again
+  bool load_failed_ = false;
 };
 
 struct LevelMesh {
@@ -45,9 +51,16 @@ enum ObjectType {
 
 constexpr int kFlagModelIndex = 82;
 
+enum class AssetResidency {
+  // every model and thumbnail is loaded up front, needed by the editor
+  kAll,
+  // only the models the current level uses are kept in memory
+  kLevel
+};
+
 class LevelEditor {
 public:
-  LevelEditor();
+  LevelEditor(AssetResidency residency = AssetResidency::kAll);
   ~LevelEditor();
 
   void UpdateCamera(FlyCamera& camera);
@@ -61,12 +74,17 @@ public:
   );
 
   void DrawThumbnails();
-  void DrawAsset(const LevelMesh& mesh, bool play_mode);
+  void DrawAsset(const LevelMesh& mesh, bool play_mode, DebugDraw& debug_draw);
   void DrawCoins(const LevelCoin& coin);
   void DrawFlag(const Flag& flag);
   
-  void SelectObject(LevelMesh& mesh, FlyCamera& camera);
-  void PlacePlayer(FlyCamera& camera);
+  void SelectObject(LevelMesh& mesh, FlyCamera& camera, DebugDraw& debug_draw);
+  void PlacePlayer(FlyCamera& camera, DebugDraw& debug_draw);
+  // selected meshes, or every mesh while C is held
+  void DrawMeshBounds(
+    const std::vector<LevelMesh>& meshes, 
+    DebugDraw& debug_draw
+  );
 
   const bool IsPlayerSetMode() const;
   const bool IsCoinMode() const;
@@ -96,7 +114,22 @@ public:
   const std::string& GetCurrentFileSaveName() const;
   const std::string& GetCurrentLoadedFileSaveName() const;
 
+  // loads the asset on demand if it isn't resident yet
   LevelAsset& GetAsset(int index);
+  const bool IsAssetLoaded(int index) const;
+
+  const int GetAssetCount() const;
+  // file name of the asset's model, e.g. "treePine.glb"
+  const std::string& GetAssetName(int index) const;
+
+  GeometryArena& GetGeometryArena();
+  MaterialPalette& GetMaterialPalette();
+
+  // with kLevel residency, loads what the level uses and releases the rest
+  void UpdateResidency(
+    const std::vector<LevelMesh>& meshes,
+    const std::vector<LevelCoin>& coins
+  );
 
   void ResetLoadedFile();
 
@@ -112,7 +145,7 @@ private:
   float player_angle_;
   Vector3 player_position_;
 private:
-  void DrawObjectBounds(const LevelMesh& mesh);
+  void DrawObjectBounds(const LevelMesh& mesh, DebugDraw& debug_draw);
 private:
   enum class Snap {
     kNone,
@@ -135,7 +168,20 @@ private:
   bool set_player_;
 
   int selected_asset_ = NO_SELECTED_ASSET;
+
+  // declared before assets_ so they outlive the models allocated from them
+  GeometryArena arena_;
+  MaterialPalette palette_;
   std::vector<LevelAsset> assets_;
+private:
+  void LoadAssets(const std::vector<int>& indices);
+  // flags and warns about an asset whose load didn't give a model
+  void CheckAssetLoaded(int index);
+
+  AssetResidency residency_;
+  // decodes for LoadAssets, started once rather than on every level load
+  ThreadPool loader_pool_;
+  std::vector<std::string> asset_filenames_;
 };
 
 
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path) {
+  Close();
+
+  HANDLE file = CreateFileA(
+    path, 
+    GENERIC_READ, 
+    FILE_SHARE_READ, 
+    nullptr, 
+    OPEN_EXISTING, 
+    FILE_ATTRIBUTE_NORMAL, 
+    nullptr
+  );
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(
+    file, 
+    nullptr, 
+    PAGE_READONLY, 
+    0, 
+    0, 
+    nullptr
+  );
+
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+  data_ = (const unsigned char*)data;
+  size_ = (size_t)size.QuadPart;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE)mapping_);
+    CloseHandle((HANDLE)file_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+  file_ = nullptr;
+  mapping_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path) {
+  Close();
+
+  int file = open(path, O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0) {
+    close(file);
+    return false;
+  }
+
+  void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  // the mapping stays valid after the descriptor is closed
+  close(file);
+
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = (const unsigned char*)data;
+  size_ = (size_t)info.st_size;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap((void*)data_, size_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+const unsigned char* MappedFile::GetData() const {
+  return data_;
+}
+
+const size_t MappedFile::GetSize() const {
+  return size_;
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Kept free of raylib so the
+// platform headers it needs don't clash with raylib's names.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const char* path);
+  void Close();
+
+  const unsigned char* GetData() const;
+  const size_t GetSize() const;
+private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+
+#ifdef _WIN32
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "MaterialPalette.h"
+
+#include <glad.h>
+
+#include <cstring>
+#include <iostream>
+
+MaterialPalette::MaterialPalette() {
+  // created lazily like the geometry arena, the editor that owns this is
+  // built before GL is guaranteed to be usable
+  ubo_ = 0;
+  dirty_ = false;
+  colors_.reserve(kMaxMaterials);
+}
+
+MaterialPalette::~MaterialPalette() {
+  if (ubo_ != 0) {
+    glDeleteBuffers(1, &ubo_);
+  }
+}
+
+const uint32_t MaterialPalette::FindOrAdd(Vector3 color) {
+  Vector4 entry = { color.x, color.y, color.z, 1.f };
+
+  for (int i = 0; i < colors_.size(); ++i) {
+    if (std::memcmp(&colors_[i], &entry, sizeof(Vector4)) == 0) {
+      return i;
+    }
+  }
+
+  if (colors_.size() < kMaxMaterials) {
+    colors_.push_back(entry);
+    dirty_ = true;
+    return colors_.size() - 1;
+  }
+
+  std::cout << "WARNING: material palette is full, reusing the closest color"
+    << std::endl;
+
+  uint32_t closest = 0;
+  float closest_distance = -1.f;
+
+  for (int i = 0; i < colors_.size(); ++i) {
+    Vector3 existing = { colors_[i].x, colors_[i].y, colors_[i].z };
+    float distance = Vector3DistanceSqr(existing, color);
+    if (closest_distance < 0.f || distance < closest_distance) {
+      closest = i;
+      closest_distance = distance;
+    }
+  }
+
+  return closest;
+}
+
+void MaterialPalette::Upload() {
+  if (ubo_ == 0) {
+    glGenBuffers(1, &ubo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferData(
+      GL_UNIFORM_BUFFER, 
+      sizeof(Vector4) * kMaxMaterials, 
+      nullptr, 
+      GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, kMaterialUniformBinding, ubo_);
+  }
+
+  if (!dirty_) {
+    return;
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+  glBufferSubData(
+    GL_UNIFORM_BUFFER, 
+    0, 
+    sizeof(Vector4) * colors_.size(), 
+    colors_.data()
+  );
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  dirty_ = false;
+}
+
+void BindMaterialPaletteBlock(Shader shader) {
+  unsigned int block_index = 
+    glGetUniformBlockIndex(shader.id, "MaterialPalette");
+  if (block_index != GL_INVALID_INDEX) {
+    glUniformBlockBinding(shader.id, block_index, kMaterialUniformBinding);
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef MATERIAL_PALETTE_H_
+#define MATERIAL_PALETTE_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cstdint>
+#include <vector>
+
+// must match the array size of the MaterialPalette block in the shaders
+constexpr int kMaxMaterials = 256;
+constexpr int kMaterialUniformBinding = 1;
+
+// Every base color used by loaded models, deduplicated and shared through
+// a uniform block. Vertices carry an index into it, so draws never set a
+// color themselves.
+class MaterialPalette {
+public:
+  MaterialPalette();
+  ~MaterialPalette();
+
+  MaterialPalette(const MaterialPalette&) = delete;
+  MaterialPalette& operator=(const MaterialPalette&) = delete;
+
+  // falls back to the closest existing color once the palette is full
+  const uint32_t FindOrAdd(Vector3 color);
+
+  // pushes new colors to the gpu, does nothing when none were added
+  void Upload();
+private:
+  unsigned int ubo_;
+  bool dirty_;
+
+  // std140 pads every vec3 array element to a vec4
+  std::vector<Vector4> colors_;
+};
+
+// points the shader's MaterialPalette block at kMaterialUniformBinding
+void BindMaterialPaletteBlock(Shader shader);
+
+#endif
@@ -0,0 +1,333 @@
+#include "MeshCache.h"
+
+#include <raymath.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+static const uint32_t AlignOffset(size_t offset) {
+  return (offset + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+static void AlignBuffer(std::vector<unsigned char>& buffer) {
+  buffer.resize(AlignOffset(buffer.size()), 0);
+}
+
+void MeshCacheWriter::BeginMesh() {
+  meshes_.push_back(MeshCacheMesh {
+    .first_primitive_ = (uint32_t)primitives_.size(),
+    .primitive_count_ = 0
+  });
+}
+
+template<typename T>
+static void AppendBytes(std::vector<unsigned char>& buffer, const T& value) {
+  const unsigned char* bytes = (const unsigned char*)&value;
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void MeshCacheWriter::AddPrimitive(
+  Vector3 base_color,
+  const std::vector<Vector3>& positions,
+  const std::vector<MeshLod>& lods
+) {
+  Vector3 min = { 0 };
+  Vector3 max = { 0 };
+
+  if (!positions.empty()) {
+    min = positions[0];
+    max = positions[0];
+  }
+
+  for (const Vector3& position : positions) {
+    min = Vector3Min(min, position);
+    max = Vector3Max(max, position);
+  }
+
+  bool is_short = positions.size() <= UINT16_MAX + 1;
+
+  MeshCachePrimitive primitive {
+    .base_color_ = base_color,
+    .min_ = min,
+    .max_ = max,
+    .vertex_offset_ = (uint32_t)vertex_data_.size(),
+    .vertex_size_ = (uint32_t)(sizeof(Vector3) * positions.size()),
+    .vertex_count_ = (uint32_t)positions.size(),
+    .index_offset_ = (uint32_t)index_data_.size(),
+    .index_size_ = 0,
+    .index_count_ = 0,
+    .index_stride_ = 
+      (uint32_t)(is_short ? sizeof(uint16_t) : sizeof(uint32_t)),
+    .lod_count_ = 0,
+    .lods_ = {}
+  };
+
+  for (const Vector3& position : positions) {
+    AppendBytes(vertex_data_, position);
+  }
+  AlignBuffer(vertex_data_);
+
+  for (const MeshLod& lod : lods) {
+    if (primitive.lod_count_ == kMaxMeshLods) {
+      break;
+    }
+
+    primitive.lods_[primitive.lod_count_++] = MeshCacheLod {
+      .first_index_ = primitive.index_count_,
+      .index_count_ = (uint32_t)lod.indices_.size(),
+      .error_ = lod.error_
+    };
+    primitive.index_count_ += lod.indices_.size();
+
+    for (uint32_t index : lod.indices_) {
+      if (is_short) {
+        AppendBytes(index_data_, (uint16_t)index);
+      } else {
+        AppendBytes(index_data_, index);
+      }
+    }
+  }
+  AlignBuffer(index_data_);
+
+  primitive.index_size_ = primitive.index_stride_ * primitive.index_count_;
+
+  primitives_.push_back(primitive);
+  meshes_.back().primitive_count_ += 1;
+}
+
+const std::vector<unsigned char> MeshCacheWriter::Finish(
+  uint64_t source_hash
+) const {
+  MeshCacheHeader header {
+    .magic_ = kMeshCacheMagic,
+    .version_ = kMeshCacheVersion,
+    .source_hash_ = source_hash,
+    .mesh_count_ = (uint32_t)meshes_.size(),
+    .primitive_count_ = (uint32_t)primitives_.size()
+  };
+
+  size_t offset = AlignOffset(sizeof(MeshCacheHeader));
+
+  header.meshes_offset_ = offset;
+  offset = AlignOffset(offset + sizeof(MeshCacheMesh) * meshes_.size());
+
+  header.primitives_offset_ = offset;
+  offset = AlignOffset(
+    offset + sizeof(MeshCachePrimitive) * primitives_.size()
+  );
+
+  header.vertex_data_offset_ = offset;
+  header.vertex_data_size_ = vertex_data_.size();
+  offset = AlignOffset(offset + vertex_data_.size());
+
+  header.index_data_offset_ = offset;
+  header.index_data_size_ = index_data_.size();
+  offset = AlignOffset(offset + index_data_.size());
+
+  std::vector<unsigned char> data(offset, 0);
+
+  std::memcpy(&data[0], &header, sizeof(header));
+
+  if (!meshes_.empty()) {
+    std::memcpy(
+      &data[header.meshes_offset_], 
+      meshes_.data(), 
+      sizeof(MeshCacheMesh) * meshes_.size()
+    );
+  }
+  if (!primitives_.empty()) {
+    std::memcpy(
+      &data[header.primitives_offset_], 
+      primitives_.data(), 
+      sizeof(MeshCachePrimitive) * primitives_.size()
+    );
+  }
+  if (!vertex_data_.empty()) {
+    std::memcpy(
+      &data[header.vertex_data_offset_], 
+      vertex_data_.data(), 
+      vertex_data_.size()
+    );
+  }
+  if (!index_data_.empty()) {
+    std::memcpy(
+      &data[header.index_data_offset_], 
+      index_data_.data(), 
+      index_data_.size()
+    );
+  }
+
+  return data;
+}
+
+const uint64_t HashBytes(const unsigned char* data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool IsRangeInside(size_t offset, size_t size, size_t total) {
+  return offset <= total && size <= total - offset;
+}
+
+bool ViewMeshCache(
+  const unsigned char* data, 
+  size_t size, 
+  uint64_t source_hash,
+  MeshCacheView* view
+) {
+  if (data == nullptr || size < sizeof(MeshCacheHeader)) {
+    return false;
+  }
+
+  const MeshCacheHeader* header = (const MeshCacheHeader*)data;
+
+  if (
+    header->magic_ != kMeshCacheMagic ||
+    header->version_ != kMeshCacheVersion ||
+    header->source_hash_ != source_hash
+  ) {
+    return false;
+  }
+
+  if (
+    !IsRangeInside(
+      header->meshes_offset_, 
+      sizeof(MeshCacheMesh) * header->mesh_count_, 
+      size
+    ) ||
+    !IsRangeInside(
+      header->primitives_offset_, 
+      sizeof(MeshCachePrimitive) * header->primitive_count_, 
+      size
+    ) ||
+    !IsRangeInside(
+      header->vertex_data_offset_, 
+      header->vertex_data_size_, 
+      size
+    ) ||
+    !IsRangeInside(
+      header->index_data_offset_, 
+      header->index_data_size_, 
+      size
+    )
+  ) {
+    return false;
+  }
+
+  view->header_ = header;
+  view->meshes_ = (const MeshCacheMesh*)(data + header->meshes_offset_);
+  view->primitives_ = 
+    (const MeshCachePrimitive*)(data + header->primitives_offset_);
+  view->vertex_data_ = data + header->vertex_data_offset_;
+  view->index_data_ = data + header->index_data_offset_;
+
+  for (int i = 0; i < header->mesh_count_; ++i) {
+    const MeshCacheMesh& mesh = view->meshes_[i];
+    if (
+      mesh.first_primitive_ > header->primitive_count_ ||
+      mesh.primitive_count_ > header->primitive_count_ - mesh.first_primitive_
+    ) {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < header->primitive_count_; ++i) {
+    const MeshCachePrimitive& primitive = view->primitives_[i];
+    if (
+      !IsRangeInside(
+        primitive.vertex_offset_, 
+        primitive.vertex_size_, 
+        header->vertex_data_size_
+      ) ||
+      !IsRangeInside(
+        primitive.index_offset_, 
+        primitive.index_size_, 
+        header->index_data_size_
+      )
+    ) {
+      return false;
+    }
+
+    if (
+      (primitive.index_stride_ != sizeof(uint16_t) && 
+        primitive.index_stride_ != sizeof(uint32_t)) ||
+      primitive.index_size_ != primitive.index_stride_ * primitive.index_count_ ||
+      primitive.vertex_size_ != sizeof(Vector3) * primitive.vertex_count_ ||
+      primitive.lod_count_ == 0 ||
+      primitive.lod_count_ > kMaxMeshLods
+    ) {
+      return false;
+    }
+
+    for (int j = 0; j < primitive.lod_count_; ++j) {
+      const MeshCacheLod& lod = primitive.lods_[j];
+      if (
+        lod.first_index_ > primitive.index_count_ ||
+        lod.index_count_ > primitive.index_count_ - lod.first_index_
+      ) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+const std::string GetMeshCachePath(const char* model_filename) {
+  std::string name = std::filesystem::path(model_filename).stem().string();
+  return "cache/models/" + name + ".gsm";
+}
+
+bool WriteMeshCache(
+  const std::string& path, 
+  const std::vector<unsigned char>& data
+) {
+  std::error_code error;
+  std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+  // several loader threads may race to create it, only the result matters
+  std::filesystem::create_directories(directory, error);
+  if (!std::filesystem::is_directory(directory, error)) {
+    return false;
+  }
+
+  // write next to the real file and swap it in, so a crash mid write
+  // never leaves a truncated cache behind
+  std::string temp_path = path + ".tmp";
+
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  file.write((const char*)data.data(), data.size());
+  file.close();
+
+  if (!file) {
+    return false;
+  }
+
+  std::filesystem::rename(temp_path, path, error);
+  return !error;
+}
+
+void AppendBakeLog(const std::string& line) {
+  // loader threads bake side by side, their lines mustn't interleave
+  static std::mutex log_mutex;
+  std::lock_guard<std::mutex> lock(log_mutex);
+
+  std::error_code error;
+  std::filesystem::create_directories(
+    std::filesystem::path(kBakeLogPath).parent_path(), 
+    error
+  );
+
+  std::ofstream file(kBakeLogPath, std::ios::app);
+  file << line << "\n";
+}
@@ -0,0 +1,136 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <raylib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked model format. Everything is fixed size and addressed by offsets
+// from the start of the file, so a mapped file can be read in place and
+// its blobs handed straight to glBufferData.
+//
+// [header][meshes][primitives][vertex blob][index blob]
+
+constexpr uint32_t kMeshCacheMagic = 0x434D5347; // "GSMC"
+constexpr uint32_t kMeshCacheVersion = 5;
+constexpr uint32_t kMaxMeshLods = 3;
+constexpr uint32_t kMeshCacheAlignment = 16;
+
+struct MeshCacheHeader {
+  uint32_t magic_;
+  uint32_t version_;
+  // of the source file and the bake settings, see LoadModelData
+  uint64_t source_hash_;
+
+  uint32_t mesh_count_;
+  uint32_t primitive_count_;
+
+  uint32_t meshes_offset_;
+  uint32_t primitives_offset_;
+
+  uint32_t vertex_data_offset_;
+  uint32_t vertex_data_size_;
+  uint32_t index_data_offset_;
+  uint32_t index_data_size_;
+};
+
+// node transforms are already baked into the vertex data
+struct MeshCacheMesh {
+  uint32_t first_primitive_;
+  uint32_t primitive_count_;
+};
+
+// a level of detail is a range of the primitive's indices, every level
+// shares the same vertices
+struct MeshCacheLod {
+  uint32_t first_index_;
+  uint32_t index_count_;
+  // furthest any vertex was moved from the full detail mesh
+  float error_;
+};
+
+struct MeshCachePrimitive {
+  Vector3 base_color_;
+  Vector3 min_;
+  Vector3 max_;
+
+  // byte offsets into the vertex and index blobs
+  uint32_t vertex_offset_;
+  uint32_t vertex_size_;
+  uint32_t vertex_count_;
+
+  uint32_t index_offset_;
+  uint32_t index_size_;
+  uint32_t index_count_;
+  // bytes per index, 2 when every index fits in 16 bits, otherwise 4
+  uint32_t index_stride_;
+
+  // lods_[0] is always the full detail mesh
+  uint32_t lod_count_;
+  MeshCacheLod lods_[kMaxMeshLods];
+};
+
+struct MeshLod {
+  std::vector<uint32_t> indices_;
+  float error_;
+};
+
+// non-owning, points into either a mapped file or a freshly baked buffer
+struct MeshCacheView {
+  const MeshCacheHeader* header_;
+  const MeshCacheMesh* meshes_;
+  const MeshCachePrimitive* primitives_;
+  const unsigned char* vertex_data_;
+  const unsigned char* index_data_;
+};
+
+class MeshCacheWriter {
+public:
+  MeshCacheWriter() = default;
+
+  void BeginMesh();
+
+  // indices are stored as 16 bit whenever the vertex count allows it, lods
+  // beyond kMaxMeshLods are dropped
+  void AddPrimitive(
+    Vector3 base_color,
+    const std::vector<Vector3>& positions,
+    const std::vector<MeshLod>& lods
+  );
+
+  const std::vector<unsigned char> Finish(uint64_t source_hash) const;
+private:
+  std::vector<MeshCacheMesh> meshes_;
+  std::vector<MeshCachePrimitive> primitives_;
+  std::vector<unsigned char> vertex_data_;
+  std::vector<unsigned char> index_data_;
+};
+
+// FNV-1a, used to notice when a source .glb changed under its cache
+const uint64_t HashBytes(const unsigned char* data, size_t size);
+
+// validates the header, version, hash and every offset before filling view
+bool ViewMeshCache(
+  const unsigned char* data, 
+  size_t size, 
+  uint64_t source_hash,
+  MeshCacheView* view
+);
+
+const std::string GetMeshCachePath(const char* model_filename);
+
+bool WriteMeshCache(
+  const std::string& path, 
+  const std::vector<unsigned char>& data
+);
+
+// the game has no console, so whatever baking has to report is appended
+// to this instead, one whole line at a time
+constexpr const char* kBakeLogPath = "cache/bake.log";
+
+void AppendBakeLog(const std::string& line);
+
+#endif
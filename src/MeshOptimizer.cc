@@ -0,0 +1,466 @@
+#include "MeshOptimizer.h"
+
+#include <raymath.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <unordered_map>
+
+void MeshOptimizeStats::Add(const MeshOptimizeStats& other) {
+  vertices_before_ += other.vertices_before_;
+  vertices_after_ += other.vertices_after_;
+  triangles_ += other.triangles_;
+  misses_before_ += other.misses_before_;
+  misses_after_ += other.misses_after_;
+}
+
+const float MeshOptimizeStats::GetAcmrBefore() const {
+  return triangles_ > 0 ? (float)misses_before_ / triangles_ : 0.f;
+}
+
+const float MeshOptimizeStats::GetAcmrAfter() const {
+  return triangles_ > 0 ? (float)misses_after_ / triangles_ : 0.f;
+}
+
+const uint32_t CountCacheMisses(
+  const std::vector<uint32_t>& indices,
+  uint32_t vertex_count,
+  int cache_size
+) {
+  // a vertex is cached while it was pushed less than cache_size misses ago
+  std::vector<uint32_t> pushed_at(vertex_count, 0);
+  uint32_t misses = 0;
+
+  for (uint32_t index : indices) {
+    if (pushed_at[index] == 0 || misses - pushed_at[index] >= cache_size) {
+      misses += 1;
+      pushed_at[index] = misses;
+    }
+  }
+
+  return misses;
+}
+
+struct PositionHash {
+  size_t operator()(const Vector3& position) const {
+    uint32_t bits[3];
+    memcpy(bits, &position, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+  }
+};
+
+struct PositionEqual {
+  bool operator()(const Vector3& a, const Vector3& b) const {
+    return memcmp(&a, &b, sizeof(Vector3)) == 0;
+  }
+};
+
+void WeldVertices(std::vector<Vector3>& positions, std::vector<uint32_t>& indices) {
+  std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> unique;
+  unique.reserve(positions.size());
+
+  std::vector<uint32_t> remap(positions.size());
+  std::vector<Vector3> welded;
+  welded.reserve(positions.size());
+
+  for (int i = 0; i < positions.size(); ++i) {
+    auto found = unique.emplace(positions[i], welded.size());
+    if (found.second) {
+      welded.push_back(positions[i]);
+    }
+    remap[i] = found.first->second;
+  }
+
+  for (uint32_t& index : indices) {
+    index = remap[index];
+  }
+
+  positions = std::move(welded);
+}
+
+constexpr int kForsythCacheSize = 32;
+
+static const float GetVertexScore(int cache_position, uint32_t remaining) {
+  if (remaining == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+
+  if (cache_position >= 0) {
+    // the last triangle's vertices get a fixed score so the next triangle
+    // doesn't simply reuse the same edge
+    if (cache_position < 3) {
+      score = 0.75f;
+    } else {
+      float scale = 1.f / (kForsythCacheSize - 3);
+      score = powf(1.f - (cache_position - 3) * scale, 1.5f);
+    }
+  }
+
+  // favour vertices with few triangles left so they don't get stranded
+  score += 2.f * powf((float)remaining, -0.5f);
+
+  return score;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // triangles using each vertex, packed into one array
+  std::vector<uint32_t> remaining(vertex_count, 0);
+  for (uint32_t index : indices) {
+    remaining[index] += 1;
+  }
+
+  std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    first_triangle[i + 1] = first_triangle[i] + remaining[i];
+  }
+
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> filled(vertex_count, 0);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    uint32_t index = indices[i];
+    adjacency[first_triangle[index] + filled[index]++] = i / 3;
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    vertex_score[i] = GetVertexScore(-1, remaining[i]);
+  }
+
+  std::vector<bool> emitted(triangle_count, false);
+
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> next_cache;
+  cache.reserve(kForsythCacheSize + 3);
+  next_cache.reserve(kForsythCacheSize + 3);
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  int best_triangle = -1;
+  size_t scan = 0;
+
+  for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+    // nothing in the cache touches a remaining triangle, start a new strip
+    if (best_triangle < 0) {
+      while (emitted[scan]) {
+        scan += 1;
+      }
+      best_triangle = scan;
+    }
+
+    const uint32_t* triangle = &indices[best_triangle * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[best_triangle] = true;
+
+    for (int i = 0; i < 3; ++i) {
+      uint32_t vertex = triangle[i];
+      uint32_t* begin = &adjacency[first_triangle[vertex]];
+      uint32_t* end = begin + remaining[vertex];
+
+      *std::find(begin, end, (uint32_t)best_triangle) = *(end - 1);
+      remaining[vertex] -= 1;
+    }
+
+    next_cache.assign(triangle, triangle + 3);
+    for (uint32_t vertex : cache) {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+        next_cache.push_back(vertex);
+      }
+    }
+
+    for (int i = 0; i < next_cache.size(); ++i) {
+      uint32_t vertex = next_cache[i];
+      cache_position[vertex] = i < kForsythCacheSize ? i : -1;
+      vertex_score[vertex] =
+        GetVertexScore(cache_position[vertex], remaining[vertex]);
+    }
+
+    // only triangles touching the cache can have changed score
+    best_triangle = -1;
+    float best_score = -1.f;
+
+    for (uint32_t vertex : next_cache) {
+      for (uint32_t i = 0; i < remaining[vertex]; ++i) {
+        uint32_t candidate = adjacency[first_triangle[vertex] + i];
+        float score =
+          vertex_score[indices[candidate * 3]] +
+          vertex_score[indices[candidate * 3 + 1]] +
+          vertex_score[indices[candidate * 3 + 2]];
+
+        if (score > best_score) {
+          best_score = score;
+          best_triangle = candidate;
+        }
+      }
+    }
+
+    next_cache.resize(std::min((int)next_cache.size(), kForsythCacheSize));
+    std::swap(cache, next_cache);
+  }
+
+  indices = std::move(result);
+}
+
+struct TriangleCluster {
+  size_t first_index_;
+  size_t index_count_;
+  float sort_key_;
+};
+
+void OptimizeOverdraw(
+  const std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices,
+  float threshold
+) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+
+  // a triangle missing the cache on all three vertices starts a cluster,
+  // so moving clusters around keeps each one's cache behaviour
+  std::vector<TriangleCluster> clusters;
+  std::vector<uint32_t> pushed_at(positions.size(), 0);
+  uint32_t misses = 0;
+
+  for (size_t i = 0; i < triangle_count; ++i) {
+    int triangle_misses = 0;
+    for (int j = 0; j < 3; ++j) {
+      uint32_t index = indices[i * 3 + j];
+      if (pushed_at[index] == 0 || misses - pushed_at[index] >= kAcmrCacheSize) {
+        misses += 1;
+        pushed_at[index] = misses;
+        triangle_misses += 1;
+      }
+    }
+
+    if (clusters.empty() || triangle_misses == 3) {
+      clusters.push_back(TriangleCluster { i * 3, 0, 0.f });
+    }
+    clusters.back().index_count_ += 3;
+  }
+
+  if (clusters.size() < 2) {
+    return;
+  }
+
+  Vector3 mesh_center = Vector3Zero();
+  for (const Vector3& position : positions) {
+    mesh_center = Vector3Add(mesh_center, position);
+  }
+  mesh_center = Vector3Scale(mesh_center, 1.f / positions.size());
+
+  // clusters far out along their own normal are likely to hide the rest
+  for (TriangleCluster& cluster : clusters) {
+    Vector3 center = Vector3Zero();
+    Vector3 normal = Vector3Zero();
+    float area = 0.f;
+
+    for (size_t i = 0; i < cluster.index_count_; i += 3) {
+      const Vector3& a = positions[indices[cluster.first_index_ + i]];
+      const Vector3& b = positions[indices[cluster.first_index_ + i + 1]];
+      const Vector3& c = positions[indices[cluster.first_index_ + i + 2]];
+
+      Vector3 cross = Vector3CrossProduct(
+        Vector3Subtract(b, a),
+        Vector3Subtract(c, a)
+      );
+      float triangle_area = Vector3Length(cross);
+
+      Vector3 triangle_center = Vector3Scale(
+        Vector3Add(Vector3Add(a, b), c),
+        1.f / 3.f
+      );
+
+      center = Vector3Add(center, Vector3Scale(triangle_center, triangle_area));
+      normal = Vector3Add(normal, cross);
+      area += triangle_area;
+    }
+
+    if (area > 0.f) {
+      center = Vector3Scale(center, 1.f / area);
+    }
+
+    cluster.sort_key_ = Vector3DotProduct(
+      Vector3Subtract(center, mesh_center),
+      Vector3Normalize(normal)
+    );
+  }
+
+  std::stable_sort(
+    clusters.begin(),
+    clusters.end(),
+    [](const TriangleCluster& a, const TriangleCluster& b) {
+      return a.sort_key_ > b.sort_key_;
+    }
+  );
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (const TriangleCluster& cluster : clusters) {
+    sorted.insert(
+      sorted.end(),
+      indices.begin() + cluster.first_index_,
+      indices.begin() + cluster.first_index_ + cluster.index_count_
+    );
+  }
+
+  uint32_t sorted_misses = CountCacheMisses(sorted, positions.size());
+  if (sorted_misses <= misses * threshold) {
+    indices = std::move(sorted);
+  }
+}
+
+void OptimizeVertexFetch(
+  std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices
+) {
+  constexpr uint32_t kUnused = UINT32_MAX;
+
+  std::vector<uint32_t> remap(positions.size(), kUnused);
+  std::vector<Vector3> reordered;
+  reordered.reserve(positions.size());
+
+  for (uint32_t& index : indices) {
+    if (remap[index] == kUnused) {
+      remap[index] = reordered.size();
+      reordered.push_back(positions[index]);
+    }
+    index = remap[index];
+  }
+
+  positions = std::move(reordered);
+}
+
+static const uint64_t GetCellKey(Vector3 position, float cell_size) {
+  // 21 bits per axis is plenty for anything a level places
+  constexpr int64_t kCellBias = 1 << 20;
+  constexpr uint64_t kCellMask = (1 << 21) - 1;
+
+  uint64_t x = (int64_t)floorf(position.x / cell_size) + kCellBias;
+  uint64_t y = (int64_t)floorf(position.y / cell_size) + kCellBias;
+  uint64_t z = (int64_t)floorf(position.z / cell_size) + kCellBias;
+
+  return ((x & kCellMask) << 42) | ((y & kCellMask) << 21) | (z & kCellMask);
+}
+
+const float SimplifyMesh(
+  const std::vector<Vector3>& positions,
+  const std::vector<uint32_t>& indices,
+  float cell_size,
+  std::vector<uint32_t>& simplified
+) {
+  std::unordered_map<uint64_t, uint32_t> cell_ids;
+  std::vector<uint32_t> vertex_cell(positions.size());
+  std::vector<Vector3> cell_average;
+  std::vector<int> cell_vertex_count;
+
+  for (int i = 0; i < positions.size(); ++i) {
+    auto found = cell_ids.emplace(
+      GetCellKey(positions[i], cell_size), 
+      cell_average.size()
+    );
+    if (found.second) {
+      cell_average.push_back(Vector3Zero());
+      cell_vertex_count.push_back(0);
+    }
+
+    uint32_t cell = found.first->second;
+    vertex_cell[i] = cell;
+    cell_average[cell] = Vector3Add(cell_average[cell], positions[i]);
+    cell_vertex_count[cell] += 1;
+  }
+
+  for (int i = 0; i < cell_average.size(); ++i) {
+    cell_average[i] = Vector3Scale(cell_average[i], 1.f / cell_vertex_count[i]);
+  }
+
+  // picking an existing vertex keeps the lod on the same vertex buffer
+  constexpr uint32_t kNoVertex = UINT32_MAX;
+  std::vector<uint32_t> representative(cell_average.size(), kNoVertex);
+  std::vector<float> best_distance(cell_average.size(), 0.f);
+
+  for (int i = 0; i < positions.size(); ++i) {
+    uint32_t cell = vertex_cell[i];
+    float distance = Vector3Distance(positions[i], cell_average[cell]);
+    if (representative[cell] == kNoVertex || distance < best_distance[cell]) {
+      representative[cell] = i;
+      best_distance[cell] = distance;
+    }
+  }
+
+  float error = 0.f;
+  for (int i = 0; i < positions.size(); ++i) {
+    error = std::max(
+      error, 
+      Vector3Distance(positions[i], positions[representative[vertex_cell[i]]])
+    );
+  }
+
+  std::set<std::array<uint32_t, 3>> seen;
+  simplified.clear();
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<uint32_t, 3> triangle = {
+      representative[vertex_cell[indices[i]]],
+      representative[vertex_cell[indices[i + 1]]],
+      representative[vertex_cell[indices[i + 2]]]
+    };
+
+    if (
+      triangle[0] == triangle[1] || 
+      triangle[1] == triangle[2] || 
+      triangle[0] == triangle[2]
+    ) {
+      continue;
+    }
+
+    // rotate the smallest index first so repeats are caught whatever
+    // vertex they start on, without touching the winding
+    std::rotate(
+      triangle.begin(), 
+      std::min_element(triangle.begin(), triangle.end()), 
+      triangle.end()
+    );
+
+    if (seen.insert(triangle).second) {
+      simplified.insert(simplified.end(), triangle.begin(), triangle.end());
+    }
+  }
+
+  return error;
+}
+
+const MeshOptimizeStats OptimizeMesh(
+  std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices,
+  bool reduce_overdraw
+) {
+  MeshOptimizeStats stats;
+  stats.vertices_before_ = positions.size();
+  stats.triangles_ = indices.size() / 3;
+  stats.misses_before_ = CountCacheMisses(indices, positions.size());
+
+  WeldVertices(positions, indices);
+  OptimizeVertexCache(indices, positions.size());
+  if (reduce_overdraw) {
+    OptimizeOverdraw(positions, indices);
+  }
+  OptimizeVertexFetch(positions, indices);
+
+  stats.vertices_after_ = positions.size();
+  stats.misses_after_ = CountCacheMisses(indices, positions.size());
+
+  return stats;
+}
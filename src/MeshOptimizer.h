@@ -0,0 +1,77 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <raylib.h>
+
+#include <cstdint>
+#include <vector>
+
+// Offline passes run while baking a model. They only reorder or merge
+// data, the rendered result stays the same.
+
+// FIFO size used when measuring ACMR
+constexpr int kAcmrCacheSize = 16;
+// an overdraw ordering may cost this much ACMR over the cache-only order
+constexpr float kOverdrawThreshold = 1.05f;
+
+struct MeshOptimizeStats {
+  uint32_t vertices_before_ = 0;
+  uint32_t vertices_after_ = 0;
+  uint32_t triangles_ = 0;
+  uint32_t misses_before_ = 0;
+  uint32_t misses_after_ = 0;
+
+  void Add(const MeshOptimizeStats& other);
+
+  // average cache miss ratio, transformed vertices per triangle
+  const float GetAcmrBefore() const;
+  const float GetAcmrAfter() const;
+};
+
+// simulated post-transform cache misses of a triangle list
+const uint32_t CountCacheMisses(
+  const std::vector<uint32_t>& indices,
+  uint32_t vertex_count,
+  int cache_size = kAcmrCacheSize
+);
+
+// merges vertices with bit-identical positions
+void WeldVertices(std::vector<Vector3>& positions, std::vector<uint32_t>& indices);
+
+// Tom Forsyth's linear-speed vertex cache optimisation
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+// Sorts cache-friendly clusters of triangles so outward facing ones come
+// first. Keeps the input order if ACMR would get worse than threshold.
+void OptimizeOverdraw(
+  const std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices,
+  float threshold = kOverdrawThreshold
+);
+
+// renumbers vertices in first-use order and drops unreferenced ones
+void OptimizeVertexFetch(
+  std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices
+);
+
+// Vertex clustering on a grid aligned to the mesh's own axes, in model
+// space before any instance transform. Every vertex snaps to the
+// vertex nearest its cell's average and triangles that collapse are
+// dropped, so the result still indexes the original positions. Returns
+// how far the furthest vertex moved.
+const float SimplifyMesh(
+  const std::vector<Vector3>& positions,
+  const std::vector<uint32_t>& indices,
+  float cell_size,
+  std::vector<uint32_t>& simplified
+);
+
+// weld, vertex cache, optionally overdraw, then vertex fetch
+const MeshOptimizeStats OptimizeMesh(
+  std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices,
+  bool reduce_overdraw
+);
+
+#endif
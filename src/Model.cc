@@ -1,6 +1,8 @@
 #include "Model.h"
 #include <utility>
 
+#include "TransformCache.h"
+
 
 ModelComponent::ModelComponent() {
   loaded_ = false;
@@ -31,21 +33,35 @@ ModelComponent::ModelComponent(float radius, Color color) {
   color_ = color;
 }
 
-ModelComponent::ModelComponent(const char* filename, Color color, bool memory) {
-  if (!memory) {
-    model_ = LoadModel(filename);
-    if (model_.meshCount > 0) {
-      loaded_ = true;
-    }
-  } else {
-    use_custom_ = true;
-    custom_model_.LoadFromMemory(filename);
-    loaded_ = true;
-  }
+ModelComponent::ModelComponent(const char* filename, Color color) {
+  model_ = LoadModel(filename);
+  loaded_ = model_.meshCount > 0;
+  use_custom_ = false;
   color_ = color;
 }
 
 ModelComponent::~ModelComponent() {
+  Unload();
+}
+
+void ModelComponent::Upload(
+  const ModelData& data, 
+  GeometryArena& arena, 
+  MaterialPalette& palette
+) {
+  Unload();
+
+  // a failed load leaves the component unloaded, not loaded and empty
+  if (!data.valid_) {
+    return;
+  }
+
+  use_custom_ = true;
+  custom_model_.Upload(data, arena, palette);
+  loaded_ = true;
+}
+
+void ModelComponent::Unload() {
   if (loaded_) {
     loaded_ = false;
     if (!use_custom_) {
@@ -56,6 +72,10 @@ ModelComponent::~ModelComponent() {
   }
 }
 
+const bool ModelComponent::IsLoaded() const {
+  return loaded_;
+}
+
 void ModelComponent::SetColor(Color color) {
   color_ = color;
 }
@@ -69,13 +89,32 @@ void ModelComponent::Draw(
   Vector3 scale,
   Quaternion rotation
 ) {
-  float angle = 0.0;
-  Vector3 rotation_axis = Vector3Zero();
+  Draw(ComposeTransform(position, rotation, scale));
+}
 
-  QuaternionToAxisAngle(rotation, &rotation_axis, &angle);
-  
-  if (!use_custom_) {
-    DrawModelEx(model_, position, rotation_axis, angle * RAD2DEG, scale, color_);
+void ModelComponent::Draw(const Matrix& transform) {
+  if (use_custom_) {
+    return;
+  }
+
+  // what DrawModelEx does once it has built its matrix, minus the axis
+  // angle round trip
+  Matrix world = MatrixMultiply(model_.transform, transform);
+
+  for (int i = 0; i < model_.meshCount; ++i) {
+    Material& material = model_.materials[model_.meshMaterial[i]];
+    Color& base = material.maps[MATERIAL_MAP_DIFFUSE].color;
+    Color previous = base;
+
+    base = Color {
+      (unsigned char)(base.r * color_.r / 255),
+      (unsigned char)(base.g * color_.g / 255),
+      (unsigned char)(base.b * color_.b / 255),
+      (unsigned char)(base.a * color_.a / 255)
+    };
+
+    DrawMesh(model_.meshes[i], material, world);
+    base = previous;
   }
 }
 
@@ -96,24 +135,62 @@ const BoundingBox ModelComponent::GetBoundingBox() const {
 }
 
 void ModelComponent::DrawCustomModel(    
-  FlyCamera& camera, 
   Shader shader,
   int model_matrix_loc,
-  int view_projection_loc,
-  int base_color_loc,
+  const QuantizationUniforms& quantization_uniforms,
   Vector3 position,
   Quaternion rotation,
   Vector3 scale
 ) {
   custom_model_.Draw(
-    camera, 
     shader, 
     model_matrix_loc, 
-    view_projection_loc, 
-    base_color_loc, 
+    quantization_uniforms,
     position, 
     rotation, 
     scale
   );
 }
 
+
+void ModelComponent::DrawCustomModelInstanced(int instance_count, int lod) {
+  if (use_custom_) {
+    custom_model_.DrawInstanced(instance_count, lod);
+  }
+}
+
+const int ModelComponent::SelectCustomModelLod(float pixels_per_unit) const {
+  if (!use_custom_) {
+    return 0;
+  }
+
+  return custom_model_.SelectLod(pixels_per_unit);
+}
+
+const CustomGeometry* ModelComponent::GetCustomGeometry() const {
+  if (!use_custom_) {
+    return nullptr;
+  }
+
+  return &custom_model_.GetGeometry();
+}
+
+const std::vector<CustomMesh>* ModelComponent::GetCustomMeshes() const {
+  if (!use_custom_) {
+    return nullptr;
+  }
+
+  return &custom_model_.GetMeshes();
+}
+
+const std::vector<float>* ModelComponent::GetCustomLodErrors() const {
+  if (!use_custom_) {
+    return nullptr;
+  }
+
+  return &custom_model_.GetLodErrors();
+}
+
+const VertexQuantization ModelComponent::GetVertexQuantization() const {
+  return custom_model_.GetVertexQuantization();
+}
@@ -13,7 +13,7 @@ public:
 
   ModelComponent(Vector3 size, Color color);
   ModelComponent(float radius, Color color);
-  ModelComponent(const char* filename, Color color, bool move);
+  ModelComponent(const char* filename, Color color);
 
   const BoundingBox GetBoundingBox() const;
 
@@ -21,6 +21,15 @@ public:
 
   ~ModelComponent();
 
+  // swaps whatever is loaded for an already decoded custom model
+  void Upload(
+    const ModelData& data, 
+    GeometryArena& arena, 
+    MaterialPalette& palette
+  );
+  void Unload();
+  const bool IsLoaded() const;
+
   void SetColor(Color color);
   const Color GetColor() const;
 
@@ -29,18 +38,29 @@ public:
     Vector3 scale = { 1.0, 1.0, 1.0 },
     Quaternion rotation = QuaternionIdentity()
   );
+  void Draw(const Matrix& transform);
 
   void DrawCustomModel(    
-    FlyCamera& camera, 
     Shader shader,
     int model_matrix_loc,
-    int view_projection_loc,
-    int base_color_loc,
+    const QuantizationUniforms& quantization_uniforms,
     Vector3 position = { 0.0, 0.0, 0.0 }, 
     Quaternion rotation = QuaternionIdentity(),
     Vector3 scale = { 1.0, 1.0, 1.0 }
   );
 
+  void DrawCustomModelInstanced(int instance_count, int lod = 0);
+
+  // always full detail for anything that isn't a custom model
+  const int SelectCustomModelLod(float pixels_per_unit) const;
+
+  // nullptr for anything that isn't a custom model
+  const CustomGeometry* GetCustomGeometry() const;
+  const std::vector<CustomMesh>* GetCustomMeshes() const;
+  const std::vector<float>* GetCustomLodErrors() const;
+  // how the custom model's positions are stored in the arena
+  const VertexQuantization GetVertexQuantization() const;
+
 private:
   bool loaded_;
   Model model_;
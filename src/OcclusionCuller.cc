@@ -0,0 +1,426 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_USE_SSE
+#endif
+
+// checked against the start of each name, so variants are picked up too
+static const char* kOccluderAssetPrefixes[] = {
+  "blockLarge",
+  "blockSnowCliff"
+};
+
+static const Vector4 TransformToClip(const Matrix& m, Vector3 v) {
+  return Vector4 {
+    m.m0 * v.x + m.m4 * v.y + m.m8 * v.z + m.m12,
+    m.m1 * v.x + m.m5 * v.y + m.m9 * v.z + m.m13,
+    m.m2 * v.x + m.m6 * v.y + m.m10 * v.z + m.m14,
+    m.m3 * v.x + m.m7 * v.y + m.m11 * v.z + m.m15
+  };
+}
+
+// x and y in pixels, z holds 1/w
+static const Vector4 ClipToScreen(Vector4 clip) {
+  float inverse_w = 1.f / clip.w;
+  return Vector4 {
+    (clip.x * inverse_w * 0.5f + 0.5f) * kOcclusionWidth,
+    (clip.y * inverse_w * 0.5f + 0.5f) * kOcclusionHeight,
+    inverse_w,
+    1.f
+  };
+}
+
+OcclusionCuller::OcclusionCuller() {
+  enabled_ = true;
+  is_valid_ = false;
+  occluded_count_ = 0;
+
+  view_projection_ = MatrixIdentity();
+  eye_ = Vector3Zero();
+  forward_ = { 0.f, 0.f, 1.f };
+
+  depth_.resize(kOcclusionWidth * kOcclusionHeight, 0.f);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+  // the worker still points at this
+  if (job_.valid()) {
+    job_.wait();
+  }
+}
+
+void OcclusionCuller::SetOccluders(
+  LevelEditor& editor,
+  const std::vector<LevelMesh>& meshes
+) {
+  if (job_.valid()) {
+    job_.wait();
+  }
+
+  occluders_.clear();
+  frame_occluders_.clear();
+
+  for (const LevelMesh& mesh : meshes) {
+    if (mesh.index_ < 0 || mesh.index_ >= editor.GetAssetCount()) {
+      continue;
+    }
+
+    const std::string& name = editor.GetAssetName(mesh.index_);
+    bool is_occluder = false;
+    for (const char* prefix : kOccluderAssetPrefixes) {
+      is_occluder = is_occluder || name.rfind(prefix, 0) == 0;
+    }
+
+    if (!is_occluder) {
+      continue;
+    }
+
+    const ModelComponent& model = editor.GetAsset(mesh.index_).model_;
+    const CustomGeometry* geometry = model.GetCustomGeometry();
+
+    // the real triangles rather than a box, a box would hide things
+    // peeking around the edges of a block that isn't a box itself
+    if (
+      geometry == nullptr ||
+      geometry->indices_.empty() ||
+      geometry->indices_.size() / 3 > kMaxOccluderTriangles
+    ) {
+      continue;
+    }
+
+    Occluder occluder;
+    occluder.indices_ = geometry->indices_;
+    for (Vector3 vertex : geometry->positions_) {
+      occluder.vertices_.push_back(Vector3Add(
+        Vector3RotateByQuaternion(vertex, mesh.rotation_),
+        mesh.pos_
+      ));
+    }
+
+    BoundingBox bounds =
+      TransformBoundingBox(model.GetBoundingBox(), mesh.pos_, mesh.rotation_);
+    occluder.center_ = Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f);
+    occluder.radius_ = Vector3Distance(bounds.min, bounds.max) * 0.5f;
+
+    occluders_.push_back(std::move(occluder));
+  }
+}
+
+void OcclusionCuller::Begin(ThreadPool& pool, CameraComponent& camera) {
+  if (job_.valid()) {
+    job_.wait();
+  }
+
+  is_valid_ = false;
+  frame_occluders_.clear();
+
+  if (!enabled_ || occluders_.empty()) {
+    return;
+  }
+
+  view_projection_ = camera.GetViewProjection();
+  eye_ = camera.GetPosition();
+  forward_ = camera.GetForward();
+
+  // biggest on screen first, roughly radius over distance
+  for (const Occluder& occluder : occluders_) {
+    frame_occluders_.push_back(&occluder);
+  }
+
+  auto coverage = [this](const Occluder* occluder) {
+    float distance_squared =
+      std::max(Vector3DistanceSqr(eye_, occluder->center_), 1e-4f);
+    return occluder->radius_ * occluder->radius_ / distance_squared;
+  };
+
+  if (frame_occluders_.size() > kMaxOccluders) {
+    std::partial_sort(
+      frame_occluders_.begin(),
+      frame_occluders_.begin() + kMaxOccluders,
+      frame_occluders_.end(),
+      [&coverage](const Occluder* a, const Occluder* b) {
+        return coverage(a) > coverage(b);
+      }
+    );
+    frame_occluders_.resize(kMaxOccluders);
+  }
+
+  job_ = pool.Submit([this]() { Rasterize(); });
+}
+
+void OcclusionCuller::Wait(CameraComponent& camera) {
+  occluded_count_ = 0;
+
+  if (!job_.valid()) {
+    is_valid_ = false;
+    return;
+  }
+
+  job_.get();
+
+  is_valid_ =
+    enabled_ &&
+    Vector3Distance(eye_, camera.GetPosition()) <= kOcclusionMaxEyeDelta &&
+    Vector3DotProduct(forward_, camera.GetForward()) >= kOcclusionMinForwardDot;
+}
+
+void OcclusionCuller::Rasterize() {
+  std::fill(depth_.begin(), depth_.end(), 0.f);
+
+  std::vector<Vector4> screen;
+
+  for (const Occluder* occluder : frame_occluders_) {
+    screen.clear();
+    for (Vector3 vertex : occluder->vertices_) {
+      Vector4 clip = TransformToClip(view_projection_, vertex);
+      // w below the near plane marks the vertex as unusable
+      screen.push_back(
+        clip.w < kCameraNear ? Vector4 { 0.f, 0.f, 0.f, 0.f } : ClipToScreen(clip)
+      );
+    }
+
+    for (int i = 0; i + 2 < occluder->indices_.size(); i += 3) {
+      Vector4 a = screen[occluder->indices_[i]];
+      Vector4 b = screen[occluder->indices_[i + 1]];
+      Vector4 c = screen[occluder->indices_[i + 2]];
+
+      // dropping a clipped triangle only makes the buffer less occluding
+      if (a.w == 0.f || b.w == 0.f || c.w == 0.f) {
+        continue;
+      }
+
+      RasterizeTriangle(a, b, c);
+    }
+  }
+}
+
+void OcclusionCuller::RasterizeTriangle(Vector4 a, Vector4 b, Vector4 c) {
+  float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  if (fabsf(area) < 1e-6f) {
+    return;
+  }
+
+  // depth is conservative either way, so winding doesn't matter
+  if (area < 0.f) {
+    std::swap(b, c);
+    area = -area;
+  }
+
+  int min_x = std::max((int)floorf(std::min({ a.x, b.x, c.x })), 0);
+  int max_x = std::min((int)ceilf(std::max({ a.x, b.x, c.x })), kOcclusionWidth - 1);
+  int min_y = std::max((int)floorf(std::min({ a.y, b.y, c.y })), 0);
+  int max_y = std::min((int)ceilf(std::max({ a.y, b.y, c.y })), kOcclusionHeight - 1);
+
+  if (min_x > max_x || min_y > max_y) {
+    return;
+  }
+
+  // edge functions as e = ex * x + ey * y + e0, positive inside
+  float e0x = b.y - c.y, e0y = c.x - b.x, e00 = b.x * c.y - b.y * c.x;
+  float e1x = c.y - a.y, e1y = a.x - c.x, e10 = c.x * a.y - c.y * a.x;
+  float e2x = a.y - b.y, e2y = b.x - a.x, e20 = a.x * b.y - a.y * b.x;
+
+  // 1/w is linear in screen space, so it is a plane over the triangle too
+  float inverse_area = 1.f / area;
+  float zx = (e0x * a.z + e1x * b.z + e2x * c.z) * inverse_area;
+  float zy = (e0y * a.z + e1y * b.z + e2y * c.z) * inverse_area;
+  float z0 = (e00 * a.z + e10 * b.z + e20 * c.z) * inverse_area;
+
+  // a texel is about 7 screen pixels, so it is only written when the
+  // triangle covers all of it, with the farthest depth found over it.
+  // testing at the center is then done against the texel's worst corner,
+  // which keeps silhouettes and slopes from hiding what peeks past them
+  e00 -= 0.5f * (fabsf(e0x) + fabsf(e0y));
+  e10 -= 0.5f * (fabsf(e1x) + fabsf(e1y));
+  e20 -= 0.5f * (fabsf(e2x) + fabsf(e2y));
+  z0 -= 0.5f * (fabsf(zx) + fabsf(zy));
+
+  min_x &= ~3;
+
+#ifdef OCCLUSION_USE_SSE
+  const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+  const __m128 zero = _mm_setzero_ps();
+
+  for (int y = min_y; y <= max_y; ++y) {
+    float py = y + 0.5f;
+
+    __m128 row_e0 = _mm_set1_ps(e0y * py + e00);
+    __m128 row_e1 = _mm_set1_ps(e1y * py + e10);
+    __m128 row_e2 = _mm_set1_ps(e2y * py + e20);
+    __m128 row_z = _mm_set1_ps(zy * py + z0);
+
+    float* row = &depth_[y * kOcclusionWidth];
+
+    for (int x = min_x; x <= max_x; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+
+      __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0x), px), row_e0);
+      __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1x), px), row_e1);
+      __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2x), px), row_e2);
+
+      __m128 inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+        _mm_cmpge_ps(w2, zero)
+      );
+      if (_mm_movemask_ps(inside) == 0) {
+        continue;
+      }
+
+      __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px), row_z);
+      __m128 old_z = _mm_loadu_ps(row + x);
+      __m128 nearest = _mm_max_ps(old_z, z);
+
+      _mm_storeu_ps(
+        row + x,
+        _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old_z))
+      );
+    }
+  }
+#else
+  for (int y = min_y; y <= max_y; ++y) {
+    float py = y + 0.5f;
+    float* row = &depth_[y * kOcclusionWidth];
+
+    for (int x = min_x; x <= max_x; ++x) {
+      float px = x + 0.5f;
+      if (
+        e0x * px + e0y * py + e00 < 0.f ||
+        e1x * px + e1y * py + e10 < 0.f ||
+        e2x * px + e2y * py + e20 < 0.f
+      ) {
+        continue;
+      }
+
+      row[x] = std::max(row[x], zx * px + zy * py + z0);
+    }
+  }
+#endif
+}
+
+const bool OcclusionCuller::IsVisible(
+  const BoundingBox& bounds,
+  Vector3 position,
+  Quaternion rotation
+) {
+  if (!is_valid_) {
+    return true;
+  }
+
+  BoundingBox box = TransformBoundingBox(bounds, position, rotation);
+
+  float min_x = kOcclusionWidth, max_x = 0.f;
+  float min_y = kOcclusionHeight, max_y = 0.f;
+  // of the nearest corner, nothing of the object can be closer
+  float nearest = 0.f;
+
+  for (int corner = 0; corner < 8; ++corner) {
+    Vector3 point = {
+      corner & 1 ? box.max.x : box.min.x,
+      corner & 2 ? box.max.y : box.min.y,
+      corner & 4 ? box.max.z : box.min.z
+    };
+
+    Vector4 clip = TransformToClip(view_projection_, point);
+    if (clip.w < kCameraNear) {
+      return true;
+    }
+
+    Vector4 screen = ClipToScreen(clip);
+    min_x = std::min(min_x, screen.x);
+    max_x = std::max(max_x, screen.x);
+    min_y = std::min(min_y, screen.y);
+    max_y = std::max(max_y, screen.y);
+    nearest = std::max(nearest, screen.z);
+  }
+
+  int first_x = std::max((int)floorf(min_x), 0);
+  int last_x = std::min((int)ceilf(max_x), kOcclusionWidth - 1);
+  int first_y = std::max((int)floorf(min_y), 0);
+  int last_y = std::min((int)ceilf(max_y), kOcclusionHeight - 1);
+
+  // off the buffer entirely, leave it to the frustum
+  if (first_x > last_x || first_y > last_y) {
+    return true;
+  }
+
+  for (int y = first_y; y <= last_y; ++y) {
+    const float* row = &depth_[y * kOcclusionWidth];
+
+#ifdef OCCLUSION_USE_SSE
+    const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    const __m128 first = _mm_set1_ps((float)first_x);
+    const __m128 last = _mm_set1_ps((float)last_x);
+    const __m128 object_z = _mm_set1_ps(nearest);
+
+    for (int x = first_x & ~3; x <= last_x; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+      __m128 in_rect =
+        _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+
+      // any pixel without a nearer occluder means part of it shows
+      __m128 uncovered = _mm_cmple_ps(_mm_loadu_ps(row + x), object_z);
+      if (_mm_movemask_ps(_mm_and_ps(in_rect, uncovered)) != 0) {
+        return true;
+      }
+    }
+#else
+    for (int x = first_x; x <= last_x; ++x) {
+      if (row[x] <= nearest) {
+        return true;
+      }
+    }
+#endif
+  }
+
+  occluded_count_ += 1;
+  return false;
+}
+
+void OcclusionCuller::SetEnabled(bool enabled) {
+  enabled_ = enabled;
+}
+
+const bool OcclusionCuller::IsEnabled() const {
+  return enabled_;
+}
+
+const bool OcclusionCuller::IsValid() const {
+  return is_valid_;
+}
+
+const Matrix& OcclusionCuller::GetViewProjection() const {
+  return view_projection_;
+}
+
+const std::vector<float>& OcclusionCuller::GetDepth() const {
+  return depth_;
+}
+
+const int OcclusionCuller::GetOccluderCount() const {
+  return frame_occluders_.size();
+}
+
+const int OcclusionCuller::GetOccludedCount() const {
+  return occluded_count_;
+}
+
+void DrawOcclusionStats(const OcclusionCuller& culler) {
+  DrawText(
+    TextFormat(
+      "OCCLUSION: %s  OCCLUDERS: %d  OCCLUDED: %d",
+      culler.IsEnabled() ? "ON" : "OFF",
+      culler.GetOccluderCount(),
+      culler.GetOccludedCount()
+    ),
+    20,
+    190,
+    24,
+    YELLOW
+  );
+}
@@ -0,0 +1,99 @@
+#ifndef OCCLUSION_CULLER_H_
+#define OCCLUSION_CULLER_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <future>
+#include <vector>
+
+#include "Camera.h"
+#include "LevelEditor.h"
+#include "ThreadPool.h"
+
+// small enough to clear and test in a fraction of a millisecond, the width
+// is a multiple of the four pixels done at a time
+constexpr int kOcclusionWidth = 256;
+constexpr int kOcclusionHeight = 128;
+
+// only the ones covering the most of the screen are rasterized
+constexpr int kMaxOccluders = 16;
+constexpr int kMaxOccluderTriangles = 512;
+
+// the depth buffer is a frame old, past this much camera movement it is
+// ignored rather than risk hiding something that just came into view
+constexpr float kOcclusionMaxEyeDelta = 0.25f;
+constexpr float kOcclusionMinForwardDot = 0.999f;
+
+struct Occluder {
+  // world space triangles
+  std::vector<Vector3> vertices_;
+  std::vector<uint32_t> indices_;
+
+  Vector3 center_;
+  float radius_;
+};
+
+// Software occlusion culling that doesn't touch the GPU. The large blocks
+// of a level are rasterized conservatively into a small depth buffer
+// holding 1/w, and objects are hidden when every pixel their screen
+// bounds cover already has an occluder nearer than the object's nearest
+// corner. Rasterizing runs on a worker while the game updates, using the
+// previous frame's camera.
+class OcclusionCuller {
+public:
+  OcclusionCuller();
+  ~OcclusionCuller();
+
+  // call when a level is set up, picks every mesh of an occluder asset
+  void SetOccluders(LevelEditor& editor, const std::vector<LevelMesh>& meshes);
+
+  // starts rasterizing the nearest occluders for this camera on the pool
+  void Begin(ThreadPool& pool, CameraComponent& camera);
+  // waits for the depth buffer, the camera is the one about to be drawn
+  void Wait(CameraComponent& camera);
+
+  const bool IsVisible(
+    const BoundingBox& bounds,
+    Vector3 position,
+    Quaternion rotation
+  );
+
+  void SetEnabled(bool enabled);
+  const bool IsEnabled() const;
+
+  // whether this frame's buffer can be tested against, valid after Wait
+  const bool IsValid() const;
+  // what the buffer was rasterized with, for tests done elsewhere
+  const Matrix& GetViewProjection() const;
+  const std::vector<float>& GetDepth() const;
+
+  const int GetOccluderCount() const;
+  const int GetOccludedCount() const;
+private:
+  void Rasterize();
+  void RasterizeTriangle(Vector4 a, Vector4 b, Vector4 c);
+private:
+  bool enabled_;
+
+  std::vector<Occluder> occluders_;
+  // picked on the main thread, read by the worker
+  std::vector<const Occluder*> frame_occluders_;
+
+  Matrix view_projection_;
+  Vector3 eye_;
+  Vector3 forward_;
+
+  std::future<void> job_;
+  bool is_valid_;
+
+  // 1/w of the nearest occluder covering the whole texel, the farthest
+  // over the texel, 0 where there is none
+  std::vector<float> depth_;
+
+  int occluded_count_;
+};
+
+void DrawOcclusionStats(const OcclusionCuller& culler);
+
+#endif
@@ -0,0 +1,132 @@
+#include "PhysicsTaskScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+static const int GetThreadCount(int thread_count) {
+  if (thread_count <= 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+
+  return std::clamp(thread_count, 1, BT_MAX_THREAD_COUNT);
+}
+
+struct EmptyLoop : public btIParallelForBody {
+  void forLoop(int begin, int end) const override {}
+};
+
+PhysicsTaskScheduler& PhysicsTaskScheduler::Get() {
+  static PhysicsTaskScheduler scheduler;
+  return scheduler;
+}
+
+PhysicsTaskScheduler::PhysicsTaskScheduler() 
+  : btITaskScheduler("ThreadPool") {
+  thread_count_ = GetThreadCount(0);
+  running_ = false;
+  loop_count_ = 0;
+
+  // the calling thread takes index 0, then the workers take theirs one at
+  // a time so worker i is always index i + 1
+  btGetCurrentThreadIndex();
+  for (int i = 0; i < thread_count_ - 1; ++i) {
+    workers_.push_back(std::make_unique<ThreadPool>(1));
+    workers_.back()->Submit([]() { btGetCurrentThreadIndex(); }).wait();
+  }
+}
+
+int PhysicsTaskScheduler::getMaxNumThreads() const {
+  // every worker plus the calling thread
+  return workers_.size() + 1;
+}
+
+int PhysicsTaskScheduler::getNumThreads() const {
+  return thread_count_;
+}
+
+void PhysicsTaskScheduler::setNumThreads(int thread_count) {
+  thread_count_ = std::clamp(thread_count, 1, getMaxNumThreads());
+}
+
+const bool PhysicsTaskScheduler::IsUsedByBullet() {
+  int loop_count = loop_count_;
+  btParallelFor(0, 1, 1, EmptyLoop());
+  return loop_count_ != loop_count;
+}
+
+const int PhysicsTaskScheduler::GetJobCount(
+  int begin, 
+  int end, 
+  int grain_size
+) const {
+  int grain_count = (end - begin + grain_size - 1) / std::max(grain_size, 1);
+  return std::clamp(grain_count, 1, thread_count_);
+}
+
+void PhysicsTaskScheduler::parallelFor(
+  int begin, 
+  int end, 
+  int grain_size, 
+  const btIParallelForBody& body
+) {
+  ++loop_count_;
+
+  int job_count = GetJobCount(begin, end, grain_size);
+  if (job_count == 1 || running_.exchange(true)) {
+    body.forLoop(begin, end);
+    return;
+  }
+
+  int count = end - begin;
+
+  jobs_.clear();
+  for (int job = 0; job < job_count - 1; ++job) {
+    int job_begin = begin + count * job / job_count;
+    int job_end = begin + count * (job + 1) / job_count;
+
+    jobs_.push_back(workers_[job]->Submit([&body, job_begin, job_end]() {
+      body.forLoop(job_begin, job_end);
+    }));
+  }
+
+  body.forLoop(begin + count * (job_count - 1) / job_count, end);
+
+  for (std::future<void>& job : jobs_) {
+    job.wait();
+  }
+
+  running_ = false;
+}
+
+btScalar PhysicsTaskScheduler::parallelSum(
+  int begin, 
+  int end, 
+  int grain_size, 
+  const btIParallelSumBody& body
+) {
+  int job_count = GetJobCount(begin, end, grain_size);
+  if (job_count == 1 || running_.exchange(true)) {
+    return body.sumLoop(begin, end);
+  }
+
+  int count = end - begin;
+
+  sums_.clear();
+  for (int job = 0; job < job_count - 1; ++job) {
+    int job_begin = begin + count * job / job_count;
+    int job_end = begin + count * (job + 1) / job_count;
+
+    sums_.push_back(workers_[job]->Submit([&body, job_begin, job_end]() {
+      return body.sumLoop(job_begin, job_end);
+    }));
+  }
+
+  btScalar sum = body.sumLoop(begin + count * (job_count - 1) / job_count, end);
+
+  for (std::future<btScalar>& job : sums_) {
+    sum += job.get();
+  }
+
+  running_ = false;
+  return sum;
+}
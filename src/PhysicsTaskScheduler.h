@@ -0,0 +1,71 @@
+#ifndef PHYSICS_TASK_SCHEDULER_H_
+#define PHYSICS_TASK_SCHEDULER_H_
+
+#include <LinearMath/btThreads.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Runs Bullet's parallel loops on our own worker threads. A loop is split
+// into one contiguous range per thread and the calling thread works the
+// last range itself, so the thread count includes the caller.
+//
+// Bullet gives every thread that touches it an index for the rest of the
+// process and sizes per thread storage from getNumThreads when it is built,
+// so like bullet's own default scheduler there is one for the process.
+// Worlds set the count they want before building anything that reads it.
+class PhysicsTaskScheduler : public btITaskScheduler {
+public:
+  // made on first use with one worker per hardware thread. the first call
+  // has to come from the thread stepping the worlds
+  static PhysicsTaskScheduler& Get();
+
+  PhysicsTaskScheduler(const PhysicsTaskScheduler&) = delete;
+  PhysicsTaskScheduler& operator=(const PhysicsTaskScheduler&) = delete;
+
+  int getMaxNumThreads() const override;
+  int getNumThreads() const override;
+  // a loop over n threads only uses the first n - 1 workers, so the
+  // indices it sees stay below n
+  void setNumThreads(int thread_count) override;
+
+  // runs an empty loop through bullet after this is set as its scheduler.
+  // a bullet built without BULLET2_MULTITHREADING runs loops in place and
+  // never calls back here
+  const bool IsUsedByBullet();
+
+  void parallelFor(
+    int begin, 
+    int end, 
+    int grain_size, 
+    const btIParallelForBody& body
+  ) override;
+  btScalar parallelSum(
+    int begin, 
+    int end, 
+    int grain_size, 
+    const btIParallelSumBody& body
+  ) override;
+private:
+  PhysicsTaskScheduler();
+
+  const int GetJobCount(int begin, int end, int grain_size) const;
+private:
+  // a pool of one each, so a job always lands on the worker it is meant for
+  std::vector<std::unique_ptr<ThreadPool>> workers_;
+  int thread_count_;
+
+  // bullet nests loops in places, a nested one runs on the thread that
+  // asked for it rather than waiting on workers that are all busy
+  std::atomic<bool> running_;
+  std::atomic<int> loop_count_;
+
+  std::vector<std::future<void>> jobs_;
+  std::vector<std::future<btScalar>> sums_;
+};
+
+#endif
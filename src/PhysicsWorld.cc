@@ -1,8 +1,75 @@
 #include "PhysicsWorld.h"
 
-PhysicsWorld::PhysicsWorld() {
-  config_ = std::make_unique<btDefaultCollisionConfiguration>();
-  dispatcher_ = std::make_unique<btCollisionDispatcher>(config_.get());
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+
+#include <cmath>
+#include <iostream>
+
+// a coin or flag the player touched during a step
+struct TouchedObject {
+  int layer_;
+  void* user_pointer_;
+};
+
+// contact callbacks run on bullet's worker threads when threaded, each
+// thread only writes its own list and the step applies them afterwards
+static std::vector<TouchedObject> touched_objects[BT_MAX_THREAD_COUNT];
+
+static void ApplyTouchedObjects() {
+  for (std::vector<TouchedObject>& touched : touched_objects) {
+    for (const TouchedObject& object : touched) {
+      if (object.layer_ == PhysicsLayer::kCoinLayer) {
+        LevelCoin* coin = (LevelCoin*)object.user_pointer_;
+        coin->collected_ = true;
+      } else if (object.layer_ == PhysicsLayer::kFlagLayer) {
+        Flag* flag = (Flag*)object.user_pointer_;
+        flag->is_touched_ = true;
+      }
+    }
+
+    touched.clear();
+  }
+}
+
+PhysicsWorld::PhysicsWorld(int thread_count, bool always_threaded) {
+  scheduler_ = nullptr;
+  thread_count_ = 1;
+
+  if (thread_count != 1 || always_threaded) {
+    PhysicsTaskScheduler& scheduler = PhysicsTaskScheduler::Get();
+    btSetTaskScheduler(&scheduler);
+
+    if (scheduler.IsUsedByBullet()) {
+      scheduler_ = &scheduler;
+      if (thread_count <= 0) {
+        thread_count = scheduler_->getMaxNumThreads();
+      }
+
+      // the dispatcher and solver pool size their per thread storage from
+      // this, so it is set before either is built
+      scheduler_->setNumThreads(thread_count);
+      thread_count_ = scheduler_->getNumThreads();
+    } else {
+      btSetTaskScheduler(btGetSequentialTaskScheduler());
+      std::cout << "WARNING: bullet was built without "
+        << "BULLET2_MULTITHREADING, stepping on one thread" << std::endl;
+    }
+  }
+
+  if (scheduler_ != nullptr) {
+    // worker threads allocate manifolds and algorithms concurrently, the
+    // default pools run out on busy levels
+    btDefaultCollisionConstructionInfo collision_info;
+    collision_info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+    collision_info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+
+    config_ = std::make_unique<btDefaultCollisionConfiguration>(collision_info);
+    dispatcher_ = std::make_unique<btCollisionDispatcherMt>(config_.get());
+  } else {
+    config_ = std::make_unique<btDefaultCollisionConfiguration>();
+    dispatcher_ = std::make_unique<btCollisionDispatcher>(config_.get());
+  }
 
   ghost_pair_callback_ = std::make_unique<btGhostPairCallback>();
 
@@ -11,13 +78,27 @@ PhysicsWorld::PhysicsWorld() {
     ->getOverlappingPairCache()
     ->setInternalGhostPairCallback(ghost_pair_callback_.get());
 
-  solver_ = std::make_unique<btSequentialImpulseConstraintSolver>();
-  world_ = std::make_unique<btDiscreteDynamicsWorld>(
-    dispatcher_.get(), 
-    overlapping_pair_cache_.get(),
-    solver_.get(),
-    config_.get()
-  );
+  if (scheduler_ != nullptr) {
+    // islands are solved in parallel, one pooled solver each, and islands
+    // too big to split use the threaded solver
+    solver_pool_ = std::make_unique<btConstraintSolverPoolMt>(thread_count_);
+    solver_ = std::make_unique<btSequentialImpulseConstraintSolverMt>();
+    world_ = std::make_unique<btDiscreteDynamicsWorldMt>(
+      dispatcher_.get(), 
+      overlapping_pair_cache_.get(),
+      solver_pool_.get(),
+      solver_.get(),
+      config_.get()
+    );
+  } else {
+    solver_ = std::make_unique<btSequentialImpulseConstraintSolver>();
+    world_ = std::make_unique<btDiscreteDynamicsWorld>(
+      dispatcher_.get(), 
+      overlapping_pair_cache_.get(),
+      solver_.get(),
+      config_.get()
+    );
+  }
 
 
   world_->setGravity(btVector3(0.0, -9.8, 0.0));
@@ -25,13 +106,32 @@ PhysicsWorld::PhysicsWorld() {
   gContactAddedCallback = OnContactAdded;
 }
 
+PhysicsWorld::~PhysicsWorld() {
+  world_.reset();
+
+  if (scheduler_ != nullptr) {
+    btSetTaskScheduler(btGetSequentialTaskScheduler());
+  }
+}
+
 void PhysicsWorld::Update(float timestep) {
-  world_->stepSimulation(timestep, 10);
+  if (scheduler_ != nullptr) {
+    // the scheduler is shared, another world may have asked for a
+    // different count than this one's storage was sized for
+    scheduler_->setNumThreads(thread_count_);
+    btSetTaskScheduler(scheduler_);
+  }
+
+  // exactly one step, the caller keeps the accumulator so gameplay code
+  // runs once per step along with it
+  world_->stepSimulation(timestep, 1, timestep);
+
+  ApplyTouchedObjects();
 }
 
 RigidBody PhysicsWorld::CreateRigidBody(
   Vector3 position, 
-  std::unique_ptr<btCollisionShape>& shape,
+  btCollisionShape* shape,
   Quaternion rotation, 
   float mass
 ) {
@@ -45,8 +145,6 @@ RigidBody PhysicsWorld::CreateRigidBody(
     rotation.w)
   );
 
-  RigidBody final_rigid_body;
- 
   btVector3 inertia;
   inertia.setZero();
 
@@ -54,6 +152,35 @@ RigidBody PhysicsWorld::CreateRigidBody(
     shape->calculateLocalInertia(mass, inertia);
   }
 
+  if (!body_pool_.empty()) {
+    RigidBody pooled_body = std::move(body_pool_.back());
+    body_pool_.pop_back();
+
+    pooled_body.motion_state_->m_startWorldTrans = transform;
+    pooled_body.motion_state_->m_graphicsWorldTrans = transform;
+
+    // back to what a freshly constructed body would have, whatever the
+    // last level set on it
+    btRigidBody* body = pooled_body.rigid_body_.get();
+    body->setCollisionFlags(0);
+    body->setUserIndex(-1);
+    body->setUserPointer(nullptr);
+    body->setCollisionShape(shape);
+    body->setMassProps(mass, inertia);
+    body->updateInertiaTensor();
+    body->setWorldTransform(transform);
+    body->setInterpolationWorldTransform(transform);
+    body->setLinearVelocity(btVector3(0.0, 0.0, 0.0));
+    body->setAngularVelocity(btVector3(0.0, 0.0, 0.0));
+    body->clearForces();
+    body->forceActivationState(ACTIVE_TAG);
+
+    world_->addRigidBody(body);
+    return pooled_body;
+  }
+
+  RigidBody final_rigid_body;
+
   final_rigid_body.motion_state_ = 
     std::make_unique<btDefaultMotionState>(transform);
   
@@ -61,7 +188,7 @@ RigidBody PhysicsWorld::CreateRigidBody(
     btRigidBody::btRigidBodyConstructionInfo(
       mass, 
       final_rigid_body.motion_state_.get(), 
-      shape.get(), 
+      shape, 
       inertia
     );
 
@@ -138,17 +265,172 @@ std::unique_ptr<btCollisionShape> PhysicsWorld::CreateSphereShape(
   return shape;
 }
 
+btCollisionShape* PhysicsWorld::GetAssetBoxShape(
+  int asset_index, 
+  Vector3 size, 
+  Vector3 scale
+) {
+  ShapeKey key { .asset_index_ = asset_index, .scale_ = scale };
+
+  auto it = shapes_.find(key);
+  if (it == shapes_.end()) {
+    it = shapes_.emplace(
+      key, 
+      BakeBoxShape(Vector3Multiply(size, scale))
+    ).first;
+  }
+
+  return it->second->shape_.get();
+}
+
+btCollisionShape* PhysicsWorld::GetAssetShape(
+  int asset_index, 
+  const std::string& asset_name,
+  const BoundingBox& bounds,
+  const CustomGeometry* geometry,
+  Vector3 scale
+) {
+  CollisionProfile profile = GetCollisionProfile(asset_name);
+  if (
+    profile == kBoxCollision || 
+    geometry == nullptr || 
+    geometry->indices_.empty()
+  ) {
+    return GetAssetBoxShape(
+      asset_index, 
+      Vector3Subtract(bounds.max, bounds.min), 
+      scale
+    );
+  }
+
+  ShapeKey key { .asset_index_ = asset_index, .scale_ = scale };
+
+  auto it = shapes_.find(key);
+  if (it != shapes_.end()) {
+    return it->second->shape_.get();
+  }
+
+  bool is_scaled = scale.x != 1.f || scale.y != 1.f || scale.z != 1.f;
+  std::unique_ptr<CollisionShape> baked;
+
+  if (profile == kHullCollision) {
+    baked = BakeHullShape(*geometry);
+    if (is_scaled) {
+      baked->shape_->setLocalScaling(btVector3(scale.x, scale.y, scale.z));
+    }
+  } else if (is_scaled) {
+    // scaling a triangle mesh directly rebuilds its bvh, so every scale
+    // wraps the one unscaled mesh and its cached bvh instead
+    btBvhTriangleMeshShape* mesh = (btBvhTriangleMeshShape*)GetAssetShape(
+      asset_index, 
+      asset_name, 
+      bounds, 
+      geometry
+    );
+
+    baked = std::make_unique<CollisionShape>();
+    baked->shape_ = std::make_unique<btScaledBvhTriangleMeshShape>(
+      mesh, 
+      btVector3(scale.x, scale.y, scale.z)
+    );
+  } else {
+    baked = BakeMeshShape(asset_name, *geometry);
+  }
+
+  return shapes_.emplace(key, std::move(baked)).first->second->shape_.get();
+}
+
 void PhysicsWorld::ReleaseBody(RigidBody* body) {
   world_->removeRigidBody(body->rigid_body_.get());
 
-  body->rigid_body_.reset();
-  body->motion_state_.reset();
+  // leaves body empty, the same as before pooling
+  body_pool_.push_back(std::move(*body));
+}
+
+static const uint64_t GetStaticCellKey(Vector3 position) {
+  int x = (int)floorf(position.x / kStaticCollisionChunkSize);
+  int z = (int)floorf(position.z / kStaticCollisionChunkSize);
+
+  return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
+
+void PhysicsWorld::BuildStaticWorld(const std::vector<StaticObject>& objects) {
+  ClearStaticWorld();
+
+  std::map<uint64_t, std::vector<const StaticObject*>> cells;
+  for (const StaticObject& object : objects) {
+    cells[GetStaticCellKey(object.position_)].push_back(&object);
+  }
+
+  for (const auto& [key, members] : cells) {
+    // the child tree keeps queries against a big chunk logarithmic
+    std::unique_ptr<btCompoundShape> compound = 
+      std::make_unique<btCompoundShape>(true, members.size());
+
+    for (const StaticObject* object : members) {
+      btTransform transform;
+      transform.setIdentity();
+      transform.setOrigin(btVector3(
+        object->position_.x, 
+        object->position_.y, 
+        object->position_.z
+      ));
+      transform.setRotation(btQuaternion(
+        object->rotation_.x, 
+        object->rotation_.y, 
+        object->rotation_.z, 
+        object->rotation_.w
+      ));
+
+      compound->addChildShape(transform, object->shape_);
+    }
+
+    // children are already in world space
+    static_bodies_.push_back(CreateRigidBody(
+      Vector3Zero(), 
+      compound.get(), 
+      QuaternionIdentity(), 
+      0.f
+    ));
+    static_shapes_.push_back(std::move(compound));
+  }
+}
+
+void PhysicsWorld::ClearStaticWorld() {
+  for (RigidBody& body : static_bodies_) {
+    ReleaseBody(&body);
+  }
+
+  static_bodies_.clear();
+  static_shapes_.clear();
+}
+
+const int PhysicsWorld::GetStaticChunkCount() const {
+  return static_bodies_.size();
+}
+
+const int PhysicsWorld::GetShapeCount() const {
+  return shapes_.size();
+}
+
+const int PhysicsWorld::GetThreadCount() const {
+  return thread_count_;
+}
+
+const int PhysicsWorld::GetPooledBodyCount() const {
+  return body_pool_.size();
 }
 
 void PhysicsWorld::SetGravity(Vector3 gravity) {
   world_->setGravity(btVector3(gravity.x, gravity.y, gravity.z));
 }
 
+void PhysicsWorld::DrawDebug(btIDebugDraw& debug_draw) {
+  world_->setDebugDrawer(&debug_draw);
+  world_->debugDrawWorld();
+  world_->setDebugDrawer(nullptr);
+}
+
 bool OnContactAdded(
   btManifoldPoint& cp, 
   const btCollisionObjectWrapper* colObj0Wrap, 
@@ -161,15 +443,13 @@ bool OnContactAdded(
   const btCollisionObject* obj1 = colObj0Wrap->getCollisionObject();
   const btCollisionObject* obj2 = colObj1Wrap->getCollisionObject();
 
-  if (obj1->getUserIndex() == PhysicsLayer::kCoinLayer) {
-    if (obj2->getUserIndex() == PhysicsLayer::kPlayerLayer) {
-      LevelCoin* coin = (LevelCoin*)obj1->getUserPointer();
-      coin->collected_ = true;
-    }
-  } else if (obj1->getUserIndex() == PhysicsLayer::kFlagLayer) {
+  if (obj1->getUserIndex() == PhysicsLayer::kCoinLayer || 
+    obj1->getUserIndex() == PhysicsLayer::kFlagLayer) {
     if (obj2->getUserIndex() == PhysicsLayer::kPlayerLayer) {
-      Flag* flag = (Flag*)obj1->getUserPointer();
-      flag->is_touched_ = true;
+      touched_objects[btGetCurrentThreadIndex()].push_back(TouchedObject {
+        .layer_ = obj1->getUserIndex(),
+        .user_pointer_ = obj1->getUserPointer()
+      });
     }
   }
 
@@ -4,11 +4,16 @@
 #include <btBulletDynamicsCommon.h>
 #include <BulletDynamics/Character/btKinematicCharacterController.h>
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
 
-#include <vector>
+#include <map>
 #include <memory>
+#include <tuple>
+#include <vector>
 
+#include "CollisionBaker.h"
 #include "LevelEditor.h"
+#include "PhysicsTaskScheduler.h"
 
 struct RigidBody {
   std::unique_ptr<btDefaultMotionState> motion_state_;
@@ -30,6 +35,36 @@ namespace conv {
   const Quaternion RotFromController(const CharacterController& controller);
 }
 
+// every instance of an asset at the same scale shares one shape
+struct ShapeKey {
+  int asset_index_;
+  Vector3 scale_;
+
+  bool operator<(const ShapeKey& other) const {
+    return 
+      std::tie(asset_index_, scale_.x, scale_.y, scale_.z) <
+      std::tie(
+        other.asset_index_, 
+        other.scale_.x, 
+        other.scale_.y, 
+        other.scale_.z
+      );
+  }
+};
+
+// Level blocks are merged into one compound per square cell on the xz
+// plane, so the broadphase tracks a proxy per cell instead of per block.
+// Off, every block is a body of its own.
+constexpr bool kMergeStaticCollision = true;
+constexpr float kStaticCollisionChunkSize = 16.f;
+
+// a level object that never moves once the level is set up
+struct StaticObject {
+  btCollisionShape* shape_;
+  Vector3 position_;
+  Quaternion rotation_;
+};
+
 enum PhysicsLayer {
   kPlayerLayer,
   kCoinLayer,
@@ -37,17 +72,54 @@ enum PhysicsLayer {
 };
 
 
+// Above one thread the world is bullet's multithreaded one, narrowphase,
+// island solving and integration run on a pool of that size. Bullet has
+// to be built with BULLET2_MULTITHREADING for the threads to be used.
+// Contact callbacks then come from worker threads too, which is why coins
+// and flags are only marked once Update's step is done.
+constexpr int kPhysicsThreadCount = 1;
+
 class PhysicsWorld {
 public:
-  PhysicsWorld();
+  // 0 picks one thread per hardware thread. always_threaded builds the
+  // multithreaded world on one thread too, so it can be timed against
+  // itself on more threads
+  explicit PhysicsWorld(
+    int thread_count = kPhysicsThreadCount, 
+    bool always_threaded = false
+  );
+  ~PhysicsWorld();
+
+  PhysicsWorld(const PhysicsWorld&) = delete;
+  PhysicsWorld& operator=(const PhysicsWorld&) = delete;
 
   void Update(float timestep);
 
   void SetGravity(Vector3 gravity);
 
+  // hands every collision object's wireframe to debug_draw
+  void DrawDebug(btIDebugDraw& debug_draw);
+
   std::unique_ptr<btCollisionShape> CreateBoxShape(Vector3 size);
   std::unique_ptr<btCollisionShape> CreateSphereShape(float radius);
 
+  // owned by the world and kept for its whole life, size is only used the
+  // first time an asset is seen at this scale
+  btCollisionShape* GetAssetBoxShape(
+    int asset_index, 
+    Vector3 size, 
+    Vector3 scale = { 1.0, 1.0, 1.0 }
+  );
+  // box, hull or triangle mesh depending on the asset's collision profile.
+  // anything without geometry falls back to a box from its bounds
+  btCollisionShape* GetAssetShape(
+    int asset_index, 
+    const std::string& asset_name,
+    const BoundingBox& bounds,
+    const CustomGeometry* geometry,
+    Vector3 scale = { 1.0, 1.0, 1.0 }
+  );
+
   CharacterController CreateController(
     float radius, 
     float height, 
@@ -55,22 +127,44 @@ public:
     Vector3 position
   );
  
+  // reuses a released body when there is one
   RigidBody CreateRigidBody(
     Vector3 position, 
-    std::unique_ptr<btCollisionShape>& shape,
+    btCollisionShape* shape,
     Quaternion rotation, 
     float mass
   );
  
+  // removes the body from the world and keeps it for the next level
   void ReleaseBody(RigidBody* body);
   void ReleaseController(CharacterController* controller);
+
+  // replaces the static world, children share the objects' shapes
+  void BuildStaticWorld(const std::vector<StaticObject>& objects);
+  void ClearStaticWorld();
+
+  const int GetStaticChunkCount() const;
+  const int GetShapeCount() const;
+  const int GetPooledBodyCount() const;
+  const int GetThreadCount() const;
 private:
+  // the process wide one, only set when threaded
+  PhysicsTaskScheduler* scheduler_;
+  int thread_count_;
+  std::unique_ptr<btConstraintSolverPoolMt> solver_pool_;
+
   std::unique_ptr<btDefaultCollisionConfiguration> config_;
   std::unique_ptr<btCollisionDispatcher> dispatcher_;
   std::unique_ptr<btBroadphaseInterface> overlapping_pair_cache_; 
   std::unique_ptr<btGhostPairCallback> ghost_pair_callback_;
   std::unique_ptr<btSequentialImpulseConstraintSolver> solver_;
   std::unique_ptr<btDiscreteDynamicsWorld> world_;
+
+  std::map<ShapeKey, std::unique_ptr<CollisionShape>> shapes_;
+  std::vector<RigidBody> body_pool_;
+
+  std::vector<std::unique_ptr<btCompoundShape>> static_shapes_;
+  std::vector<RigidBody> static_bodies_;
 };
 
 bool OnContactAdded(
@@ -1,5 +1,15 @@
 #include "PlayerMovement.h"
 
+#include <cmath>
+
+#include "FixedTimestep.h"
+
+// the blend factors below were tuned as fractions per tick at the default
+// tick rate, this gives the same decay per second at any other rate
+static const float GetTickBlend(float blend, float timestep) {
+  return 1.f - powf(1.f - blend, timestep * kDefaultTickRate);
+}
+
 PlayerMovement::PlayerMovement() {
   walk_ = Vector3Zero();  
 
@@ -9,6 +19,9 @@ PlayerMovement::PlayerMovement() {
   current_speed_ = walk_speed_;
 
   sprint_ = false;
+
+  sprint_pressed_ = false;
+  jump_pressed_ = false;
   
   stand_jump_height_ = 5.0;
   crouched_jump_height_ = 2.5;
@@ -32,7 +45,16 @@ PlayerMovement::PlayerMovement() {
 }
 
 
-void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
+void PlayerMovement::PollInput() {
+  sprint_pressed_ = sprint_pressed_ || IsKeyPressed(KEY_LEFT_SHIFT);
+  jump_pressed_ = jump_pressed_ || IsKeyPressed(KEY_SPACE);
+}
+
+void PlayerMovement::Update(
+  CharacterController& player, 
+  FlyCamera& camera, 
+  float timestep
+) {
     Vector3 forward = camera.GetCamera().GetForward();
     forward.y = 0.0;
     Vector3 right = camera.GetCamera().GetRight(); 
@@ -52,21 +74,39 @@ void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
       move_dir = Vector3Add(move_dir, right);
     } 
 
-    if (IsKeyPressed(KEY_LEFT_SHIFT) && stamina_ > 1.0) {
+    bool sprint_pressed = sprint_pressed_;
+    bool jump_pressed = jump_pressed_;
+    sprint_pressed_ = false;
+    jump_pressed_ = false;
+
+    if (sprint_pressed && stamina_ > 1.0) {
       sprint_ = true;   
     } else if (IsKeyUp(KEY_LEFT_SHIFT) || stamina_ <= 1.0) {
       sprint_ = false;
     }
 
+    // fraction of a default length tick this one covers
+    float tick_scale = timestep * kDefaultTickRate;
+
     if (sprint_ && player.controller_->onGround()) { 
-      current_speed_ = Lerp(current_speed_, run_speed_, 0.2 / 10.0); 
+      current_speed_ = Lerp(
+        current_speed_, 
+        run_speed_, 
+        GetTickBlend(0.2 / 10.0, timestep)
+      ); 
     } else {
       if (player.controller_->onGround()) { 
-        current_speed_ = Lerp(current_speed_, walk_speed_, 0.2 / 10.0);
+        current_speed_ = Lerp(
+          current_speed_, 
+          walk_speed_, 
+          GetTickBlend(0.2 / 10.0, timestep)
+        );
       }
     }
 
-    float speed_magnitude = Vector3Length(walk_);
+    // walk_ is a distance per tick, measured as if the tick were default
+    // length so the thresholds hold at any rate
+    float speed_magnitude = Vector3Length(walk_) / tick_scale;
 
     // bunch of hard values for comparing to speed magnitude. need to change
     // if speed is changed. bunch of conditions for certain movement effects
@@ -81,7 +121,11 @@ void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
 
     if (IsKeyDown(KEY_LEFT_CONTROL) && player.controller_->onGround()) {
       current_jump_height_ = crouched_jump_height_;
-      current_speed_ = Lerp(current_speed_, crouch_speed_, 0.5 / 10.0);
+      current_speed_ = Lerp(
+        current_speed_, 
+        crouch_speed_, 
+        GetTickBlend(0.5 / 10.0, timestep)
+      );
       player.ghost_object_->setCollisionShape(crouched_capsule_.get()); 
 
       if (!Vector3Equals(move_dir, Vector3Zero())) {
@@ -103,7 +147,7 @@ void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
       sliding_ = false;
     }
 
-    if (IsKeyPressed(KEY_SPACE) && player.controller_->onGround()) {
+    if (jump_pressed && player.controller_->onGround()) {
       if (sliding_ && speed_magnitude > slide_jump_threshold) { 
         stamina_ -= slide_jump_stamina_drain_;
         Vector3 forward_force = Vector3Scale(forward, 5.0);
@@ -122,36 +166,48 @@ void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
     }
 
     if (speed_magnitude < stamina_regen_threshold && !sliding_) {
-      stamina_ = Lerp(stamina_, max_stamina_ + 1, 2.0 * GetFrameTime());
+      stamina_ = Lerp(stamina_, max_stamina_ + 1, 2.0 * timestep);
     }  
 
     if (!Vector3Equals(move_dir, Vector3Zero()) && !sliding_) {
       move_dir = Vector3Normalize(move_dir);
-      walk_ = Vector3Scale(move_dir, current_speed_ * GetFrameTime());
+      walk_ = Vector3Scale(move_dir, current_speed_ * timestep);
     } else {
       if (player.controller_->onGround()) {
         if (!sliding_) {
-          walk_ = Vector3Lerp(walk_, Vector3Zero(), ground_friction_);
+          walk_ = Vector3Lerp(
+            walk_, 
+            Vector3Zero(), 
+            GetTickBlend(ground_friction_, timestep)
+          );
         } else {
-          walk_ = Vector3Lerp(walk_, Vector3Zero(), slide_friction_);
+          walk_ = Vector3Lerp(
+            walk_, 
+            Vector3Zero(), 
+            GetTickBlend(slide_friction_, timestep)
+          );
         }
       } else {
-        walk_ = Vector3Lerp(walk_, Vector3Zero(), air_friction_);
+        walk_ = Vector3Lerp(
+          walk_, 
+          Vector3Zero(), 
+          GetTickBlend(air_friction_, timestep)
+        );
       }
     } 
 
     if (speed_magnitude > camera_sprint_zoom_threshold) {
       float fov = camera.GetCamera().GetFOV();
-      fov = Lerp(fov, 100.f, 0.8f / 10.0);
+      fov = Lerp(fov, 100.f, GetTickBlend(0.8f / 10.0, timestep));
       camera.GetCamera().SetFOV(fov);
     } else if (speed_magnitude < camera_walk_zoom_threshold) {
       float fov = camera.GetCamera().GetFOV();
-      fov = Lerp(fov, 90.f, 0.8f / 10.0);
+      fov = Lerp(fov, 90.f, GetTickBlend(0.8f / 10.0, timestep));
       camera.GetCamera().SetFOV(fov);
     }
 
     if (sprint_ && speed_magnitude > 0.01) {
-      stamina_ = Lerp(stamina_, stamina_ - sprint_stamina_drain_, 0.1);
+      stamina_ -= sprint_stamina_drain_ * 0.1 * tick_scale;
     }
 
 
@@ -164,16 +220,18 @@ void PlayerMovement::Update(CharacterController& player, FlyCamera& camera) {
         walk_.z
       )
     ); 
+}
 
-    btCapsuleShape* capsule = 
-      (btCapsuleShape*)player.ghost_object_->getCollisionShape();
+const Vector3 PlayerMovement::GetEyePosition(
+  const CharacterController& player
+) const {
+  btCapsuleShape* capsule = 
+    (btCapsuleShape*)player.ghost_object_->getCollisionShape();
 
-    camera.GetCamera().SetPosition(
-      Vector3Add(
-        conv::PosFromController(player),
-        { 0.f, capsule->getHalfHeight(), 0.f }
-      )
-    );
+  return Vector3Add(
+    conv::PosFromController(player),
+    { 0.f, capsule->getHalfHeight(), 0.f }
+  );
 }
 
 const float PlayerMovement::GetStamina() const {
@@ -7,7 +7,15 @@
 class PlayerMovement {
 public:
   PlayerMovement();
-  void Update(CharacterController& player, FlyCamera& camera);
+  // once per rendered frame, so presses between two ticks aren't lost
+  void PollInput();
+  // once per fixed tick, before the physics step
+  void Update(
+    CharacterController& player, 
+    FlyCamera& camera, 
+    float timestep
+  );
+  const Vector3 GetEyePosition(const CharacterController& player) const;
   void ResetStamina();
   const float GetStamina() const;
 private:
@@ -19,6 +27,10 @@ private:
   float current_speed_;
 
   bool sprint_;
+
+  // latched by PollInput until the next tick uses them
+  bool sprint_pressed_;
+  bool jump_pressed_;
   
   float stand_jump_height_;
   float crouched_jump_height_;
@@ -0,0 +1,164 @@
+#include "RenderQueue.h"
+
+#include <glad.h>
+#include <raylib.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Camera.h"
+
+// bit layout from the top: layer, distance band, program, vao, material,
+// then the exact distance. GL names past the field widths only cost some
+// grouping, the packet still binds its real program and VAO
+constexpr int kLayerShift = 62;
+constexpr int kBandShift = 58;
+constexpr int kProgramShift = 48;
+constexpr int kVaoShift = 38;
+constexpr int kMaterialShift = 24;
+
+constexpr uint64_t kBandMask = (1 << 4) - 1;
+constexpr uint64_t kProgramMask = (1 << 10) - 1;
+constexpr uint64_t kVaoMask = (1 << 10) - 1;
+constexpr uint64_t kMaterialMask = (1 << 14) - 1;
+constexpr uint64_t kDepthMask = (1 << 24) - 1;
+
+static const uint64_t MakeSortKey(
+  RenderLayer layer,
+  unsigned int program,
+  unsigned int vao,
+  uint32_t material,
+  float depth
+) {
+  // bands double in size with distance, one per octave past a unit away
+  float clamped_depth = std::max(depth, 1.f);
+  uint64_t band = std::min((uint64_t)log2f(clamped_depth), kBandMask);
+
+  uint64_t quantized_depth = (uint64_t)(
+    std::clamp(depth / kCameraFar, 0.f, 1.f) * kDepthMask
+  );
+
+  return
+    ((uint64_t)layer << kLayerShift) |
+    (band << kBandShift) |
+    ((program & kProgramMask) << kProgramShift) |
+    ((vao & kVaoMask) << kVaoShift) |
+    ((material & kMaterialMask) << kMaterialShift) |
+    quantized_depth;
+}
+
+RenderQueue::RenderQueue() {
+  stats_ = { 0 };
+}
+
+void RenderQueue::Clear() {
+  packets_.clear();
+}
+
+void RenderQueue::Add(
+  RenderLayer layer,
+  RenderSubmitter* submitter,
+  int index,
+  unsigned int program,
+  unsigned int vao,
+  uint32_t material,
+  int first_instance,
+  int instance_count,
+  float depth
+) {
+  packets_.push_back(RenderPacket {
+    .key_ = MakeSortKey(layer, program, vao, material, depth),
+    .submitter_ = submitter,
+    .index_ = index,
+    .program_ = program,
+    .vao_ = vao,
+    .material_ = material,
+    .first_instance_ = first_instance,
+    .instance_count_ = instance_count,
+    .depth_ = depth
+  });
+}
+
+static void CountStateChanges(
+  const std::vector<RenderPacket>& packets,
+  int* program_changes,
+  int* vao_changes
+) {
+  *program_changes = 0;
+  *vao_changes = 0;
+
+  for (int i = 0; i < packets.size(); ++i) {
+    if (i == 0 || packets[i].program_ != packets[i - 1].program_) {
+      ++*program_changes;
+    }
+    if (i == 0 || packets[i].vao_ != packets[i - 1].vao_) {
+      ++*vao_changes;
+    }
+  }
+}
+
+void RenderQueue::Submit() {
+  stats_ = { 0 };
+  stats_.packets_ = packets_.size();
+
+  CountStateChanges(
+    packets_,
+    &stats_.unsorted_program_changes_,
+    &stats_.unsorted_vao_changes_
+  );
+
+  std::sort(
+    packets_.begin(),
+    packets_.end(),
+    [](const RenderPacket& a, const RenderPacket& b) {
+      return a.key_ < b.key_;
+    }
+  );
+
+  bool is_bound = false;
+  unsigned int program = 0;
+  unsigned int vao = 0;
+
+  for (const RenderPacket& packet : packets_) {
+    if (!is_bound || packet.program_ != program) {
+      program = packet.program_;
+      glUseProgram(program);
+      ++stats_.program_changes_;
+    }
+
+    if (!is_bound || packet.vao_ != vao) {
+      vao = packet.vao_;
+      glBindVertexArray(vao);
+      ++stats_.vao_changes_;
+    }
+
+    is_bound = true;
+    packet.submitter_->SubmitPacket(packet);
+  }
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+}
+
+const RenderQueueStats& RenderQueue::GetStats() const {
+  return stats_;
+}
+
+void DrawRenderQueueStats(const RenderQueue& queue) {
+  const RenderQueueStats& stats = queue.GetStats();
+
+  DrawText(
+    TextFormat(
+      "PACKETS: %d  PROGRAMS: %d (%d)  VAOS: %d (%d)",
+      stats.packets_,
+      stats.program_changes_,
+      stats.unsorted_program_changes_,
+      stats.vao_changes_,
+      stats.unsorted_vao_changes_
+    ),
+    20,
+    160,
+    24,
+    YELLOW
+  );
+}
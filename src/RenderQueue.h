@@ -0,0 +1,86 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <cstdint>
+#include <vector>
+
+// sorted by this first, the sky fills whatever opaque geometry left empty
+enum RenderLayer {
+  kOpaqueLayer,
+  kSkyLayer
+};
+
+struct RenderPacket;
+
+// Anything that puts packets in the queue. The queue has the packet's
+// program and VAO bound by the time it calls back, so the draw itself must
+// leave both of them alone.
+class RenderSubmitter {
+public:
+  virtual ~RenderSubmitter() = default;
+  virtual void SubmitPacket(const RenderPacket& packet) = 0;
+};
+
+struct RenderPacket {
+  uint64_t key_;
+
+  RenderSubmitter* submitter_;
+  // whatever the submitter needs to find its draw again, a batch index say
+  int index_;
+
+  unsigned int program_;
+  unsigned int vao_;
+  uint32_t material_;
+
+  // range of the frame's instance transforms the draw reads from
+  int first_instance_;
+  int instance_count_;
+
+  // distance from the eye to the nearest thing the packet draws
+  float depth_;
+};
+
+struct RenderQueueStats {
+  int packets_;
+  int program_changes_;
+  int vao_changes_;
+  // what the same packets would have cost in the order they were added
+  int unsorted_program_changes_;
+  int unsorted_vao_changes_;
+};
+
+// Collects the frame's draws and sorts them by a packed 64-bit key before
+// any GL call is made. Opaque packets are grouped into coarse distance
+// bands front to back so early-Z still rejects most hidden fragments, and
+// inside a band by program, VAO and material so state changes are rare.
+// Program and VAO binds are only issued when they differ from the last
+// packet's.
+class RenderQueue {
+public:
+  RenderQueue();
+
+  void Clear();
+
+  void Add(
+    RenderLayer layer,
+    RenderSubmitter* submitter,
+    int index,
+    unsigned int program,
+    unsigned int vao,
+    uint32_t material,
+    int first_instance,
+    int instance_count,
+    float depth
+  );
+
+  void Submit();
+
+  const RenderQueueStats& GetStats() const;
+private:
+  std::vector<RenderPacket> packets_;
+  RenderQueueStats stats_;
+};
+
+void DrawRenderQueueStats(const RenderQueue& queue);
+
+#endif
@@ -5,6 +5,8 @@
 
 #include <raylib-physfs.h>
 
+#include "CameraUniforms.h"
+
 Skybox::Skybox() {
   glDepthFunc(GL_LEQUAL);
 
@@ -62,9 +64,7 @@ Skybox::Skybox() {
     "assets/shaders/skybox.frag"
   );
 
-  uniform_projection_ = GetShaderLocation(skybox_shader_, "matProjection");
-
-  uniform_view_ = GetShaderLocation(skybox_shader_, "matView");
+  BindCameraUniformBlock(skybox_shader_);
 
   uniform_environment_map_ = GetShaderLocation(
     skybox_shader_, 
@@ -143,38 +143,27 @@ Skybox::~Skybox() {
 }
 
 
-void Skybox::Draw(FlyCamera& camera) {
-
-  Vector3 position = camera.GetCamera().GetPosition();
-  Vector3 forward = camera.GetCamera().GetForward();
-
-  float screen_width = (float)GetScreenWidth();
-  float screen_height = (float)GetScreenHeight();
-
-  
-  Matrix projection = MatrixPerspective(
-    camera.GetCamera().GetFOV() * DEG2RAD,
-    screen_width / screen_height, 
-    0.01, 
-    100.0
+void Skybox::Enqueue(RenderQueue& queue) {
+  queue.Add(
+    kSkyLayer, 
+    this, 
+    0, 
+    skybox_shader_.id, 
+    cube_vao_, 
+    0, 
+    0, 
+    1, 
+    0.f
   );
-  
-  Matrix view = MatrixLookAt(
-    position, 
-    Vector3Add(position, forward), 
-    { 0.f, 1.f, 0.f }
-  );
-
-  SetShaderValueMatrix(skybox_shader_, uniform_projection_, projection);
-  SetShaderValueMatrix(skybox_shader_, uniform_view_, view);
+}
 
+void Skybox::SubmitPacket(const RenderPacket& packet) {
   glDepthMask(GL_FALSE);
-  glUseProgram(skybox_shader_.id);
+  rlDisableBackfaceCulling();
 
-  glBindVertexArray(cube_vao_);
   glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id_);
   glDrawArrays(GL_TRIANGLES, 0, 36);
 
+  rlEnableBackfaceCulling();
   glDepthMask(GL_TRUE);
 }
-
@@ -5,13 +5,17 @@
 #include <rlgl.h>
 #include <stdint.h>
 
-#include "FlyCamera.h"
+#include "RenderQueue.h"
 
-class Skybox {
+class Skybox : public RenderSubmitter {
 public:
   Skybox();
   ~Skybox();
-  void Draw(FlyCamera& camera);
+
+  // always drawn last, after opaque geometry has filled the depth buffer
+  void Enqueue(RenderQueue& queue);
+
+  void SubmitPacket(const RenderPacket& packet) override;
 private:
   uint32_t texture_id_;
   Shader skybox_shader_;
@@ -19,8 +23,6 @@ private:
   uint32_t cube_vao_;
   uint32_t cube_vbo_;
 
-  int uniform_projection_;
-  int uniform_view_;
   int uniform_environment_map_;
 };
 
@@ -0,0 +1,306 @@
+#include "StaticBatch.h"
+
+#include <glad.h>
+#include <raylib-physfs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CameraUniforms.h"
+
+static const uint64_t GetCellKey(Vector3 position) {
+  int x = (int)floorf(position.x / kStaticChunkSize);
+  int z = (int)floorf(position.z / kStaticChunkSize);
+
+  return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
+
+static void HashBytes(const void* data, size_t size, uint64_t* hash) {
+  // fnv-1a, only has to notice that a cell's objects changed
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; ++i) {
+    *hash ^= bytes[i];
+    *hash *= 0x100000001b3ull;
+  }
+}
+
+static const float GetBoxDistance(const BoundingBox& box, Vector3 point) {
+  Vector3 closest = Vector3Min(Vector3Max(point, box.min), box.max);
+  return Vector3Distance(closest, point);
+}
+
+StaticBatch::StaticBatch() {
+  shader_ = LoadShaderFromPhysFS(
+    "assets/shaders/model.vert",
+    "assets/shaders/model.frag"
+  );
+  model_loc_ = GetShaderLocation(shader_, "model");
+  quantization_uniforms_ = GetQuantizationUniforms(shader_.id);
+  BindCameraUniformBlock(shader_);
+  BindMaterialPaletteBlock(shader_);
+
+  arena_ = nullptr;
+
+  rebuilt_count_ = 0;
+  vertex_count_ = 0;
+}
+
+StaticBatch::~StaticBatch() {
+  Clear();
+  UnloadShader(shader_);
+}
+
+void StaticBatch::Clear() {
+  for (auto& [key, chunk] : chunks_) {
+    FreeChunk(chunk);
+  }
+
+  chunks_.clear();
+  batched_assets_.clear();
+  visible_.clear();
+
+  rebuilt_count_ = 0;
+  vertex_count_ = 0;
+}
+
+void StaticBatch::FreeChunk(StaticChunk& chunk) {
+  if (arena_ != nullptr && chunk.index_count_ > 0) {
+    arena_->Free(chunk.range_);
+  }
+
+  chunk.index_count_ = 0;
+}
+
+void StaticBatch::Build(
+  LevelEditor& editor,
+  const std::vector<LevelMesh>& meshes,
+  const ImpostorRenderer& impostors
+) {
+  arena_ = &editor.GetGeometryArena();
+
+  // decided per asset the level actually places, so nothing else is loaded
+  batched_assets_.assign(editor.GetAssetCount(), false);
+
+  std::map<uint64_t, std::vector<int>> cells;
+  for (int i = 0; i < meshes.size(); ++i) {
+    int asset_index = meshes[i].index_;
+    if (
+      asset_index < 0 ||
+      asset_index >= batched_assets_.size() ||
+      impostors.IsImpostorAsset(asset_index) ||
+      editor.GetAsset(asset_index).model_.GetCustomGeometry() == nullptr
+    ) {
+      continue;
+    }
+
+    batched_assets_[asset_index] = true;
+    cells[GetCellKey(meshes[i].pos_)].push_back(i);
+  }
+
+  for (auto& [key, chunk] : chunks_) {
+    chunk.is_used_ = false;
+  }
+
+  rebuilt_count_ = 0;
+
+  for (const auto& [key, members] : cells) {
+    uint64_t signature = 0xcbf29ce484222325ull;
+    for (int member : members) {
+      const LevelMesh& mesh = meshes[member];
+      HashBytes(&mesh.index_, sizeof(mesh.index_), &signature);
+      HashBytes(&mesh.pos_, sizeof(mesh.pos_), &signature);
+      HashBytes(&mesh.rotation_, sizeof(mesh.rotation_), &signature);
+    }
+
+    auto it = chunks_.find(key);
+    if (it != chunks_.end() && it->second.signature_ == signature) {
+      it->second.is_used_ = true;
+      continue;
+    }
+
+    if (it == chunks_.end()) {
+      it = chunks_.emplace(key, StaticChunk { 0 }).first;
+    } else {
+      FreeChunk(it->second);
+    }
+
+    BuildChunk(editor, meshes, members, &it->second);
+    it->second.signature_ = signature;
+    it->second.is_used_ = true;
+    ++rebuilt_count_;
+  }
+
+  // cells that emptied out since the last build
+  for (auto it = chunks_.begin(); it != chunks_.end();) {
+    if (!it->second.is_used_) {
+      FreeChunk(it->second);
+      it = chunks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  vertex_count_ = 0;
+  for (const auto& [key, chunk] : chunks_) {
+    vertex_count_ += chunk.vertex_count_;
+  }
+}
+
+void StaticBatch::BuildChunk(
+  LevelEditor& editor,
+  const std::vector<LevelMesh>& meshes,
+  const std::vector<int>& members,
+  StaticChunk* chunk
+) {
+  positions_.clear();
+  materials_.clear();
+  indices_.clear();
+
+  for (int member : members) {
+    const LevelMesh& mesh = meshes[member];
+    const CustomGeometry* geometry =
+      editor.GetAsset(mesh.index_).model_.GetCustomGeometry();
+
+    uint32_t first_vertex = positions_.size();
+
+    for (Vector3 position : geometry->positions_) {
+      positions_.push_back(Vector3Add(
+        Vector3RotateByQuaternion(position, mesh.rotation_),
+        mesh.pos_
+      ));
+    }
+
+    materials_.insert(
+      materials_.end(),
+      geometry->materials_.cbegin(),
+      geometry->materials_.cend()
+    );
+
+    for (uint32_t index : geometry->indices_) {
+      indices_.push_back(first_vertex + index);
+    }
+  }
+
+  chunk->index_count_ = indices_.size();
+  chunk->vertex_count_ = positions_.size();
+  if (indices_.empty()) {
+    chunk->bounds_ = { 0 };
+    return;
+  }
+
+  chunk->bounds_ = { positions_[0], positions_[0] };
+  for (Vector3 position : positions_) {
+    chunk->bounds_.min = Vector3Min(chunk->bounds_.min, position);
+    chunk->bounds_.max = Vector3Max(chunk->bounds_.max, position);
+  }
+
+  // same rule as the mesh cache, half the index bandwidth when it fits
+  const unsigned char* index_data = (const unsigned char*)indices_.data();
+  uint32_t index_size = sizeof(uint32_t) * indices_.size();
+  chunk->index_type_ = GL_UNSIGNED_INT;
+
+  if (positions_.size() <= 65536) {
+    short_indices_.assign(indices_.cbegin(), indices_.cend());
+    index_data = (const unsigned char*)short_indices_.data();
+    index_size = sizeof(uint16_t) * short_indices_.size();
+    chunk->index_type_ = GL_UNSIGNED_SHORT;
+  }
+
+  chunk->quantization_ = GetVertexQuantization(chunk->bounds_);
+  chunk->range_ = arena_->Allocate(
+    (const unsigned char*)positions_.data(),
+    positions_.size(),
+    index_data,
+    index_size,
+    materials_.data(),
+    chunk->quantization_
+  );
+}
+
+const bool StaticBatch::IsBatched(int asset_index) const {
+  return
+    asset_index >= 0 &&
+    asset_index < batched_assets_.size() &&
+    batched_assets_[asset_index];
+}
+
+void StaticBatch::Enqueue(
+  RenderQueue& queue, 
+  ViewCuller& culler, 
+  OcclusionCuller& occlusion,
+  Vector3 eye
+) {
+  visible_.clear();
+
+  for (const auto& [key, chunk] : chunks_) {
+    if (
+      chunk.index_count_ == 0 ||
+      !culler.IsVisible(chunk.bounds_, Vector3Zero(), QuaternionIdentity()) ||
+      !occlusion.IsVisible(chunk.bounds_, Vector3Zero(), QuaternionIdentity())
+    ) {
+      continue;
+    }
+
+    queue.Add(
+      kOpaqueLayer,
+      this,
+      visible_.size(),
+      shader_.id,
+      arena_->GetVertexArray(),
+      0,
+      0,
+      1,
+      GetBoxDistance(chunk.bounds_, eye)
+    );
+    visible_.push_back(&chunk);
+  }
+}
+
+void StaticBatch::SubmitPacket(const RenderPacket& packet) {
+  const StaticChunk& chunk = *visible_[packet.index_];
+
+  // positions are already in world space
+  glUniformMatrix4fv(model_loc_, 1, GL_FALSE, MatrixToFloatV(MatrixIdentity()).v);
+  SetQuantizationUniforms(quantization_uniforms_, chunk.quantization_);
+
+  glDrawElementsBaseVertex(
+    GL_TRIANGLES,
+    chunk.index_count_,
+    chunk.index_type_,
+    (void*)(uintptr_t)chunk.range_.index_offset_,
+    chunk.range_.first_vertex_
+  );
+}
+
+const int StaticBatch::GetChunkCount() const {
+  return chunks_.size();
+}
+
+const int StaticBatch::GetRebuiltCount() const {
+  return rebuilt_count_;
+}
+
+const int StaticBatch::GetVertexCount() const {
+  return vertex_count_;
+}
+
+const int StaticBatch::GetVisibleCount() const {
+  return visible_.size();
+}
+
+void DrawStaticBatchStats(const StaticBatch& batch) {
+  DrawText(
+    TextFormat(
+      "STATIC BATCH: %d CHUNKS  %d DRAWN  %d REBUILT  %d VERTICES",
+      batch.GetChunkCount(),
+      batch.GetVisibleCount(),
+      batch.GetRebuiltCount(),
+      batch.GetVertexCount()
+    ),
+    20,
+    280,
+    24,
+    YELLOW
+  );
+}
@@ -0,0 +1,106 @@
+#ifndef STATIC_BATCH_H_
+#define STATIC_BATCH_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Culling.h"
+#include "GeometryArena.h"
+#include "ImpostorRenderer.h"
+#include "LevelEditor.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+
+// side of the square cells on the xz plane that level meshes are merged in
+constexpr float kStaticChunkSize = 16.f;
+
+struct StaticChunk {
+  // hash of every object in the cell, rebuilt only when it changes
+  uint64_t signature_;
+  BoundingBox bounds_;
+
+  ArenaRange range_;
+  VertexQuantization quantization_;
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  unsigned int index_type_;
+  int index_count_;
+  int vertex_count_;
+
+  bool is_used_;
+};
+
+// Level meshes never move once a level is set up, so they are baked into
+// pre-transformed geometry merged per chunk of the level. Every chunk is
+// one draw and is culled as a whole. Rebuilding only touches chunks whose
+// objects changed, so moving one block in the editor re-bakes one chunk.
+// Assets with an impostor stay on the instanced path to keep their fade.
+class StaticBatch : public RenderSubmitter {
+public:
+  StaticBatch();
+  ~StaticBatch();
+
+  void Build(
+    LevelEditor& editor,
+    const std::vector<LevelMesh>& meshes,
+    const ImpostorRenderer& impostors
+  );
+  void Clear();
+
+  // whether meshes of this asset are drawn by the batch since the last build
+  const bool IsBatched(int asset_index) const;
+
+  // chunks are tested whole against the frustum and the occlusion buffer
+  void Enqueue(
+    RenderQueue& queue, 
+    ViewCuller& culler, 
+    OcclusionCuller& occlusion,
+    Vector3 eye
+  );
+
+  void SubmitPacket(const RenderPacket& packet) override;
+
+  const int GetChunkCount() const;
+  // chunks baked again by the last build
+  const int GetRebuiltCount() const;
+  const int GetVertexCount() const;
+  // chunks queued by the last Enqueue
+  const int GetVisibleCount() const;
+private:
+  void BuildChunk(
+    LevelEditor& editor,
+    const std::vector<LevelMesh>& meshes,
+    const std::vector<int>& members,
+    StaticChunk* chunk
+  );
+  void FreeChunk(StaticChunk& chunk);
+private:
+  Shader shader_;
+  int model_loc_;
+  QuantizationUniforms quantization_uniforms_;
+
+  GeometryArena* arena_;
+
+  // keyed by packed cell coordinates
+  std::map<uint64_t, StaticChunk> chunks_;
+  std::vector<bool> batched_assets_;
+
+  // chunks queued this frame, packets index into it
+  std::vector<const StaticChunk*> visible_;
+
+  int rebuilt_count_;
+  int vertex_count_;
+
+  // reused between chunk builds
+  std::vector<Vector3> positions_;
+  std::vector<uint32_t> materials_;
+  std::vector<uint32_t> indices_;
+  std::vector<uint16_t> short_indices_;
+};
+
+void DrawStaticBatchStats(const StaticBatch& batch);
+
+#endif
@@ -0,0 +1,54 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int thread_count) {
+  stopping_ = false;
+
+  if (thread_count <= 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+
+  if (thread_count <= 0) {
+    thread_count = 1;
+  }
+
+  for (int i = 0; i < thread_count; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+const int ThreadPool::GetThreadCount() const {
+  return workers_.size();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+
+      // drain whatever is queued before shutting down
+      if (tasks_.empty()) {
+        return;
+      }
+
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+
+    task();
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+  // 0 picks one worker per hardware thread
+  explicit ThreadPool(int thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template <typename Task>
+  std::future<std::invoke_result_t<Task>> Submit(Task task);
+
+  const int GetThreadCount() const;
+private:
+  void WorkerLoop();
+private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_;
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> ThreadPool::Submit(Task task) {
+  using Result = std::invoke_result_t<Task>;
+
+  // std::function needs a copyable callable, packaged_task isn't one
+  auto packaged = 
+    std::make_shared<std::packaged_task<Result()>>(std::move(task));
+  std::future<Result> result = packaged->get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.emplace([packaged]() { (*packaged)(); });
+  }
+  condition_.notify_one();
+
+  return result;
+}
+
+#endif
@@ -0,0 +1,317 @@
+#include "TransformCache.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_USE_SSE
+#endif
+
+enum TransformLane {
+  kPositionX,
+  kPositionY,
+  kPositionZ,
+  kRotationX,
+  kRotationY,
+  kRotationZ,
+  kRotationW,
+  kLaneCount
+};
+
+// same terms as QuaternionToMatrix, one object per call
+static void ComposeOneTransform(
+  float x, 
+  float y, 
+  float z, 
+  float w, 
+  float position_x, 
+  float position_y, 
+  float position_z, 
+  float* v
+) {
+  float xx = x * x, yy = y * y, zz = z * z;
+  float xy = x * y, xz = x * z, yz = y * z;
+  float wx = w * x, wy = w * y, wz = w * z;
+
+  v[0] = 1.f - 2.f * (yy + zz);
+  v[1] = 2.f * (xy + wz);
+  v[2] = 2.f * (xz - wy);
+  v[3] = 0.f;
+
+  v[4] = 2.f * (xy - wz);
+  v[5] = 1.f - 2.f * (xx + zz);
+  v[6] = 2.f * (yz + wx);
+  v[7] = 0.f;
+
+  v[8] = 2.f * (xz + wy);
+  v[9] = 2.f * (yz - wx);
+  v[10] = 1.f - 2.f * (xx + yy);
+  v[11] = 0.f;
+
+  v[12] = position_x;
+  v[13] = position_y;
+  v[14] = position_z;
+  v[15] = 1.f;
+}
+
+// four objects at a time with SSE, one per lane, the rest one by one
+static void ComposeTransforms(
+  const float* __restrict position_x,
+  const float* __restrict position_y,
+  const float* __restrict position_z,
+  const float* __restrict rotation_x,
+  const float* __restrict rotation_y,
+  const float* __restrict rotation_z,
+  const float* __restrict rotation_w,
+  int count,
+  float16* __restrict matrices
+) {
+  int i = 0;
+
+#ifdef TRANSFORM_USE_SSE
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 two = _mm_set1_ps(2.f);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(rotation_x + i);
+    __m128 y = _mm_loadu_ps(rotation_y + i);
+    __m128 z = _mm_loadu_ps(rotation_z + i);
+    __m128 w = _mm_loadu_ps(rotation_w + i);
+
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y);
+    __m128 zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z);
+    __m128 yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y);
+    __m128 wz = _mm_mul_ps(w, z);
+
+    // columns[c][r] is row r of column c for all four objects
+    __m128 columns[4][4] = {
+      {
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+        _mm_mul_ps(two, _mm_add_ps(xy, wz)),
+        _mm_mul_ps(two, _mm_sub_ps(xz, wy)),
+        zero
+      },
+      {
+        _mm_mul_ps(two, _mm_sub_ps(xy, wz)),
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+        _mm_mul_ps(two, _mm_add_ps(yz, wx)),
+        zero
+      },
+      {
+        _mm_mul_ps(two, _mm_add_ps(xz, wy)),
+        _mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))),
+        zero
+      },
+      {
+        _mm_loadu_ps(position_x + i),
+        _mm_loadu_ps(position_y + i),
+        _mm_loadu_ps(position_z + i),
+        one
+      }
+    };
+
+    // afterwards columns[c][k] is all of column c for object k
+    for (int column = 0; column < 4; ++column) {
+      _MM_TRANSPOSE4_PS(
+        columns[column][0], 
+        columns[column][1], 
+        columns[column][2], 
+        columns[column][3]
+      );
+    }
+
+    for (int k = 0; k < 4; ++k) {
+      float* v = matrices[i + k].v;
+      for (int column = 0; column < 4; ++column) {
+        _mm_storeu_ps(v + column * 4, columns[column][k]);
+      }
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    ComposeOneTransform(
+      rotation_x[i],
+      rotation_y[i],
+      rotation_z[i],
+      rotation_w[i],
+      position_x[i],
+      position_y[i],
+      position_z[i],
+      matrices[i].v
+    );
+  }
+}
+
+const Matrix ComposeTransform(
+  Vector3 position,
+  Quaternion rotation,
+  Vector3 scale
+) {
+  float16 composed;
+  ComposeOneTransform(
+    rotation.x,
+    rotation.y,
+    rotation.z,
+    rotation.w,
+    position.x,
+    position.y,
+    position.z,
+    composed.v
+  );
+
+  // scaling first only stretches the rotation's columns
+  const float* v = composed.v;
+  return Matrix {
+    v[0] * scale.x, v[4] * scale.y, v[8] * scale.z, v[12],
+    v[1] * scale.x, v[5] * scale.y, v[9] * scale.z, v[13],
+    v[2] * scale.x, v[6] * scale.y, v[10] * scale.z, v[14],
+    0.f, 0.f, 0.f, 1.f
+  };
+}
+
+TransformCache::TransformCache() {
+  all_dirty_ = false;
+  updated_count_ = 0;
+}
+
+void TransformCache::Resize(int count) {
+  int old_count = matrices_.size();
+  if (count == old_count) {
+    return;
+  }
+
+  for (std::vector<float>* lane : {
+    &position_x_, &position_y_, &position_z_,
+    &rotation_x_, &rotation_y_, &rotation_z_, &rotation_w_
+  }) {
+    lane->resize(count, 0.f);
+  }
+  matrices_.resize(count);
+  dirty_.resize(count, 0);
+
+  dirty_indices_.erase(
+    std::remove_if(
+      dirty_indices_.begin(),
+      dirty_indices_.end(),
+      [count](int index) { return index >= count; }
+    ),
+    dirty_indices_.end()
+  );
+
+  for (int i = old_count; i < count; ++i) {
+    rotation_w_[i] = 1.f;
+    dirty_[i] = 1;
+    dirty_indices_.push_back(i);
+  }
+}
+
+const int TransformCache::GetCount() const {
+  return matrices_.size();
+}
+
+void TransformCache::Set(int index, Vector3 position, Quaternion rotation) {
+  if (
+    position_x_[index] == position.x &&
+    position_y_[index] == position.y &&
+    position_z_[index] == position.z &&
+    rotation_x_[index] == rotation.x &&
+    rotation_y_[index] == rotation.y &&
+    rotation_z_[index] == rotation.z &&
+    rotation_w_[index] == rotation.w
+  ) {
+    return;
+  }
+
+  position_x_[index] = position.x;
+  position_y_[index] = position.y;
+  position_z_[index] = position.z;
+  rotation_x_[index] = rotation.x;
+  rotation_y_[index] = rotation.y;
+  rotation_z_[index] = rotation.z;
+  rotation_w_[index] = rotation.w;
+
+  if (!dirty_[index]) {
+    dirty_[index] = 1;
+    dirty_indices_.push_back(index);
+  }
+}
+
+void TransformCache::Invalidate() {
+  all_dirty_ = true;
+}
+
+void TransformCache::Update() {
+  int count = matrices_.size();
+
+  updated_count_ = 0;
+  if (!all_dirty_ && dirty_indices_.empty()) {
+    return;
+  }
+
+  // a whole level at once, the lanes are already contiguous
+  if (all_dirty_ || (int)dirty_indices_.size() * 2 > count) {
+    ComposeTransforms(
+      position_x_.data(),
+      position_y_.data(),
+      position_z_.data(),
+      rotation_x_.data(),
+      rotation_y_.data(),
+      rotation_z_.data(),
+      rotation_w_.data(),
+      count,
+      matrices_.data()
+    );
+    updated_count_ = count;
+  } else {
+    // gather the few that moved so the kernel still sees packed lanes
+    int dirty_count = dirty_indices_.size();
+    const std::vector<float>* lanes[kLaneCount] = {
+      &position_x_, &position_y_, &position_z_,
+      &rotation_x_, &rotation_y_, &rotation_z_, &rotation_w_
+    };
+
+    for (int lane = 0; lane < kLaneCount; ++lane) {
+      batch_[lane].resize(dirty_count);
+      for (int i = 0; i < dirty_count; ++i) {
+        batch_[lane][i] = (*lanes[lane])[dirty_indices_[i]];
+      }
+    }
+    batch_matrices_.resize(dirty_count);
+
+    ComposeTransforms(
+      batch_[kPositionX].data(),
+      batch_[kPositionY].data(),
+      batch_[kPositionZ].data(),
+      batch_[kRotationX].data(),
+      batch_[kRotationY].data(),
+      batch_[kRotationZ].data(),
+      batch_[kRotationW].data(),
+      dirty_count,
+      batch_matrices_.data()
+    );
+
+    for (int i = 0; i < dirty_count; ++i) {
+      matrices_[dirty_indices_[i]] = batch_matrices_[i];
+    }
+    updated_count_ = dirty_count;
+  }
+
+  for (int index : dirty_indices_) {
+    dirty_[index] = 0;
+  }
+  dirty_indices_.clear();
+  all_dirty_ = false;
+}
+
+const float16& TransformCache::GetMatrix(int index) const {
+  return matrices_[index];
+}
+
+const int TransformCache::GetUpdatedCount() const {
+  return updated_count_;
+}
@@ -0,0 +1,61 @@
+#ifndef TRANSFORM_CACHE_H_
+#define TRANSFORM_CACHE_H_
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cstdint>
+#include <vector>
+
+// scale, then rotation, then translation, built straight from the
+// quaternion rather than multiplying three matrices together
+const Matrix ComposeTransform(
+  Vector3 position,
+  Quaternion rotation,
+  Vector3 scale = { 1.0, 1.0, 1.0 }
+);
+
+// Column major world matrices for a list of objects. Positions and
+// rotations are kept as a structure of arrays, so a batch is recomputed
+// four objects at a time with SSE, one per lane. Only objects whose
+// position or rotation changed since the last Update are recomputed.
+class TransformCache {
+public:
+  TransformCache();
+
+  // new objects start out dirty, existing ones keep their matrices
+  void Resize(int count);
+  const int GetCount() const;
+
+  // only marks the object dirty when something actually changed
+  void Set(int index, Vector3 position, Quaternion rotation);
+  void Invalidate();
+
+  void Update();
+
+  const float16& GetMatrix(int index) const;
+  // objects recomputed by the last Update
+  const int GetUpdatedCount() const;
+private:
+  std::vector<float> position_x_;
+  std::vector<float> position_y_;
+  std::vector<float> position_z_;
+  std::vector<float> rotation_x_;
+  std::vector<float> rotation_y_;
+  std::vector<float> rotation_z_;
+  std::vector<float> rotation_w_;
+
+  std::vector<float16> matrices_;
+
+  std::vector<uint8_t> dirty_;
+  std::vector<int> dirty_indices_;
+  bool all_dirty_;
+
+  // dirty objects gathered into contiguous lanes
+  std::vector<float> batch_[7];
+  std::vector<float16> batch_matrices_;
+
+  int updated_count_;
+};
+
+#endif